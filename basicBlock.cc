@@ -19,8 +19,7 @@ bool basicBlock::hasJR(bool isRet) const {
     if(isRet) {
       for(const auto & p : vecIns) {
 	if(is_jr(p.inst)) {
-	  riscv_t m(p.inst);
-	  return (m.jj.rs1 == 1) or (m.jj.rs1 == 5);
+	  return is_ret(p.inst);
 	}
       }
       return false;
@@ -73,7 +72,7 @@ void basicBlock::repairBrokenEdges() {
 
 void basicBlock::dumpCFG() {
   std::ofstream out("cfg.txt");
-  for(auto &p : bbMap) {
+  for(auto &p : bbMap.sorted()) {
     basicBlock *bb = p.second;
     out << *bb;
   }
@@ -91,11 +90,8 @@ void basicBlock::dropAllBBs() {
 }
 
 basicBlock *basicBlock::bbInBlock(uint64_t pc) {
-  auto it = insMap.find(pc);
-  if(it == insMap.end()) {
-    return nullptr;
-  }
-  return it->second;
+  basicBlock **b = insMap.find(pc);
+  return b ? *b : nullptr;
 }
 
 void basicBlock::setReadOnly() {
@@ -139,7 +135,7 @@ bool basicBlock::mergableWithSucc() const {
     return false;
   }
   auto sbb = *(succs.begin());
-  if(sbb->preds.size() != 1) {
+  if((sbb == this) or (sbb->preds.size() != 1)) {
     return false;
   }
   return true;
@@ -175,14 +171,14 @@ bool basicBlock::mergeWithSucc() {
     addSuccessor(nbb);
   }
 
+  size_t base = vecIns.size();
   for(auto c : sbb->vecIns) {
-    vecIns.emplace_back(c.inst,c.pc,c.vpc);
-    auto it = insMap.find(c.pc);
-    insMap.erase(it);
-    insMap[c.pc] = this;
+    vecIns.push_back(c);
   }
-  auto it = bbMap.find(sbb->entryAddr);
-  bbMap.erase(it);
+  for(size_t i = 0, len = sbb->vecIns.size(); i < len; ) {
+    i += insMap.reassign(sbb->vecIns[i].pc, this, base + i);
+  }
+  bbMap.erase(sbb->entryAddr);
   edgeCnts = sbb->edgeCnts;
   
   //std::cout << "old edge count size " << sbb->edgeCnts.size() << "\n";
@@ -214,11 +210,17 @@ void basicBlock::addSuccessor(basicBlock *bb) {
   succs.insert(bb);
   succsMap[bb->entryAddr] = bb;
   bb->preds.insert(this);
+  if(logChanges) {
+    changes.push_back(change{change::kind::edge, this, bb});
+  }
 
 }
 
 basicBlock::basicBlock(uint64_t entryAddr) : execUnit(), entryAddr(entryAddr) {
   bbMap[entryAddr] = this;  
+  if(logChanges) {
+    changes.push_back(change{change::kind::block, this, nullptr});
+  }
 }
 
 basicBlock::basicBlock(uint64_t entryAddr, basicBlock *prev) : basicBlock(entryAddr) {
@@ -227,10 +229,10 @@ basicBlock::basicBlock(uint64_t entryAddr, basicBlock *prev) : basicBlock(entryA
 
 
 
-void basicBlock::addIns(uint32_t inst, uint64_t addr, uint64_t vpc) {
+void basicBlock::addIns(uint32_t inst, uint64_t addr, uint64_t vpc, uint32_t prof) {
   if(not(readOnly)) {
-    vecIns.emplace_back(inst,addr,vpc);
-    insMap[addr] = this;
+    vecIns.emplace_back(inst,addr,vpc,prof);
+    insMap.insert(addr, this, vecIns.size() - 1);
   }
 }
 
@@ -255,20 +257,15 @@ basicBlock *basicBlock::split(uint64_t nEntryAddr) {
 	    << " cfgInRegions.size() = " << cfgInRegions.size() 
 	    << std::endl;
 #endif
-  /* dumb linear search because VA != PA */
-  ssize_t offs = 0;
-  bool found = false;
-  for(auto &p : vecIns) {
-    if(p.pc == nEntryAddr) {
-      found = true;
-      break;
-    }
-    offs++;
-  }
-  assert(found);
+  size_t offs = 0;
+  basicBlock **owner = insMap.find(nEntryAddr, offs);
+  assert(owner and (*owner == this));
   dropCompiledCode();
 
   basicBlock *nBB = new basicBlock(nEntryAddr);
+  if(logChanges) {
+    changes.back() = change{change::kind::split, this, nBB};
+  }
   
 
   //unlink old successors and update with new block
@@ -287,11 +284,10 @@ basicBlock *basicBlock::split(uint64_t nEntryAddr) {
   succs.insert(nBB);
   nBB->preds.insert(this);
   
-  for(size_t i = offs, len = vecIns.size(); i < len; i++) {
-    uint64_t addr = i*4 + entryAddr;
-    insMap[addr] = nBB;
-    nBB->vecIns.push_back(vecIns[i]);
+  for(size_t i = offs, len = vecIns.size(); i < len; ) {
+    i += insMap.reassign(vecIns[i].pc, nBB, i - offs);
   }
+  nBB->vecIns.assign(vecIns.begin() + offs, vecIns.end());
 
   vecIns.erase(vecIns.begin() + offs, vecIns.end());
 
@@ -315,11 +311,8 @@ basicBlock *basicBlock::split(uint64_t nEntryAddr) {
 }
 
 basicBlock *basicBlock::globalFindBlock(uint64_t entryAddr) {
-  auto it = bbMap.find(entryAddr);
-  if(it == bbMap.end())
-    return nullptr;
-  else
-    return it->second;
+  basicBlock **b = bbMap.find(entryAddr);
+  return b ? *b : nullptr;
 }
 
 basicBlock *basicBlock::localFindBlock(uint64_t entryAddr) {
@@ -341,18 +334,20 @@ basicBlock *basicBlock::findBlock(uint64_t entryAddr) {
     fBlock = sIt->second;
   }
   else {
-    auto bIt =  bbMap.find(entryAddr);
-    if(bIt != bbMap.end()) {
-      fBlock = bIt->second;
+    basicBlock **bIt = bbMap.find(entryAddr);
+    if(bIt) {
+      fBlock = *bIt;
       addSuccessor(fBlock);
     }
     else {
-      auto iIt = insMap.find(entryAddr);
-      if(iIt != insMap.end()) {
-	basicBlock *sBB = iIt->second;
+      basicBlock **iIt = insMap.find(entryAddr);
+      if(iIt) {
+	basicBlock *sBB = *iIt;
 	basicBlock *nBB = sBB->split(entryAddr);
 	fBlock = nBB;
-	addSuccessor(fBlock);
+	/* splitting this block moves its terminal, and so the
+	 * edge, to the new tail */
+	(sBB == this ? nBB : this)->addSuccessor(fBlock);
       }
     }
   }
@@ -374,10 +369,10 @@ double basicBlock::getTipCycles() const {
     return 0.0;
   }
   
+  const pc_profile &prof = cfgCplr->getProfile();
   double c = 0.0;
-  for(size_t i = 0, l = vecIns.size(); i < l; i++){
-    uint64_t addr = entryAddr + i*4;
-    c += cfgCplr->getTipCycles(addr);
+  for(const instruction &ins : vecIns) {
+    c += prof.cycles_at(ins.prof);
   }
   return c;
 }
@@ -414,7 +409,7 @@ std::ostream &operator<<(std::ostream &out, const basicBlock &bb) {
   for(auto pbb : bb.preds) {
     uint64_t t = pbb->getTermAddr();
     uint64_t e = bb.getEntryAddr();
-    uint64_t w = basicBlock::globalEdges[t][e];    
+    uint64_t w = basicBlock::globalEdges.get(t, e);
     out << " " << hex << pbb->getEntryAddr() << dec << "(" << w << ")";
     
   }
@@ -13,6 +13,8 @@
 
 #include "riscv.hh"
 #include "execUnit.hh"
+#include "pc_map.hh"
+#include "pc_runs.hh"
 
 class compile;
 class regionCFG;
@@ -24,27 +26,41 @@ class basicBlock : public execUnit {
 public:
   struct instruction {
     uint32_t inst;
+    /* dense pc_profile index */
+    uint32_t prof;
     uint64_t pc;
     uint64_t vpc;
-    instruction(uint32_t inst, uint64_t pc, uint64_t vpc) :
-      inst(inst), pc(pc), vpc(vpc) {}
+    instruction(uint32_t inst, uint64_t pc, uint64_t vpc, uint32_t prof) :
+      inst(inst), prof(prof), pc(pc), vpc(vpc) {}
   };
   typedef std::vector<instruction, backtrace_allocator<instruction>> insContainer;
-  static std::map<uint64_t, std::map<uint64_t, uint64_t>> globalEdges;  
+  static edge_map globalEdges;
+  /* what the build makes, in order, while logChanges is set : block a,
+   * a split of a with tail b, or an edge a -> b. follow mode plays
+   * them into its live region (regionCFG::followChanges) */
+  struct change {
+    enum class kind {block, split, edge};
+    kind k;
+    basicBlock *a, *b;
+  };
+  static bool logChanges;
+  static std::vector<change> changes;
 private:
   friend std::ostream &operator<<(std::ostream &out, const basicBlock &bb);
   friend int main(int, char**);
   friend class compile;
   friend class region;
   friend class regionCFG;
+  friend class cfg_cache;
   struct orderBasicBlocks {
     bool operator() (const basicBlock *a, const basicBlock *b) const {
       return a->getEntryAddr() < b->getEntryAddr();
     }
   };
   static uint64_t cfgCnt;
-  static std::map<uint64_t, basicBlock*> bbMap;
-  static std::map<uint64_t, basicBlock*> insMap;
+  static pc_map<basicBlock*> bbMap;
+  /* instruction pc -> block and offset in its vecIns */
+  static pc_runs<basicBlock*> insMap;
   uint64_t entryAddr=0,termAddr = 0;  
   std::set<basicBlock*, orderBasicBlocks> preds,succs;
   std::map<uint32_t, basicBlock *> succsMap;
@@ -78,7 +94,7 @@ public:
   void print() const;
   void repairBrokenEdges();
   ssize_t sizeInBytes() const;
-  void addIns(uint32_t inst, uint64_t addr, uint64_t vpc);
+  void addIns(uint32_t inst, uint64_t addr, uint64_t vpc, uint32_t prof);
   basicBlock(uint64_t entryAddr, basicBlock *prev);
   basicBlock(uint64_t entryAddr);
   bool empty() const {
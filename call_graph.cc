@@ -0,0 +1,156 @@
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "call_graph.hh"
+#include "riscv.hh"
+
+uint32_t call_graph::func(uint64_t entry) {
+  uint32_t &e = index[entry];
+  if(e == 0) {
+    entries.push_back(entry);
+    funcs.emplace_back();
+    active.push_back(0);
+    e = funcs.size();
+  }
+  return e - 1;
+}
+
+uint32_t call_graph::edge(uint32_t caller, uint32_t callee) {
+  uint32_t &e = edge_index[(static_cast<uint64_t>(caller) << 32) | callee];
+  if(e == 0) {
+    edge_ends.emplace_back(caller, callee);
+    edges.emplace_back();
+    edge_active.push_back(0);
+    e = edges.size();
+  }
+  return e - 1;
+}
+
+void call_graph::push(uint64_t entry, uint64_t ret_pc, bool call) {
+  uint32_t f = func(entry), e = none;
+  if(call) {
+    funcs[f].calls++;
+    e = edge(stack.back().func, f);
+    edges[e].calls++;
+  }
+  if(stack.size() == max_depth) {
+    return;
+  }
+  active[f]++;
+  if(e != none) {
+    edge_active[e]++;
+  }
+  stack.push_back(frame{f, e, ret_pc, insns, cycles});
+}
+
+void call_graph::pop() {
+  const frame &fr = stack.back();
+  if(--active[fr.func] == 0) {
+    funcs[fr.func].incl_insns += insns - fr.insns;
+    funcs[fr.func].incl_cycles += cycles - fr.cycles;
+  }
+  if((fr.edge != none) and (--edge_active[fr.edge] == 0)) {
+    edges[fr.edge].incl_insns += insns - fr.insns;
+    edges[fr.edge].incl_cycles += cycles - fr.cycles;
+  }
+  stack.pop_back();
+}
+
+void call_graph::retire(const inst_record &ir, uint64_t npc, bool known) {
+  if(stack.empty()) {
+    push(ir.pc, ~0UL, false);
+  }
+  uint32_t i = prof.find(ir.pc);
+  double c = ((i == pc_profile::no_index) or (prof.count_at(i) == 0)) ? 0.0 : prof.cpi_at(i);
+  stats &s = funcs[stack.back().func];
+  s.self_insns++;
+  s.self_cycles += c;
+  insns++;
+  cycles += c;
+  if(not(known)) {
+    return;
+  }
+  if(is_jal(ir.inst) or is_jalr(ir.inst)) {
+    push(npc, ir.pc + 4, true);
+  }
+  else if(is_ret(ir.inst)) {
+    for(size_t d = stack.size(); d > 1; d--) {
+      if(stack[d-1].ret_pc == npc) {
+	while(stack.size() >= d) {
+	  pop();
+	}
+	break;
+      }
+    }
+  }
+}
+
+void call_graph::add(const inst_record &ir) {
+  if(pending) {
+    retire(last, ir.pc, true);
+  }
+  last = ir;
+  pending = true;
+}
+
+void call_graph::finish() {
+  if(pending) {
+    retire(last, 0, false);
+    pending = false;
+  }
+  while(not(stack.empty())) {
+    pop();
+  }
+}
+
+bool call_graph::write(const std::string &fname) const {
+  std::ofstream out(fname);
+  if(not(out.good())) {
+    return false;
+  }
+  auto hotter = [](const stats &a, uint64_t ea, const stats &b, uint64_t eb) {
+    if(a.incl_cycles != b.incl_cycles) {
+      return a.incl_cycles > b.incl_cycles;
+    }
+    return ea < eb;
+  };
+  std::vector<uint32_t> order(funcs.size());
+  std::vector<std::vector<uint32_t>> callees(funcs.size());
+  for(uint32_t f = 0; f < funcs.size(); f++) {
+    order[f] = f;
+  }
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return hotter(funcs[a], entries[a], funcs[b], entries[b]);
+    });
+  for(uint32_t e = 0; e < edges.size(); e++) {
+    callees[edge_ends[e].first].push_back(e);
+  }
+  double total = (cycles == 0.0) ? 1.0 : cycles;
+  out << std::fixed << std::setprecision(2);
+  for(uint32_t f : order) {
+    const stats &s = funcs[f];
+    out << "func " << std::hex << entries[f] << std::dec
+	<< ", calls " << s.calls
+	<< ", incl cycles " << s.incl_cycles
+	<< " (" << (100.0 * s.incl_cycles / total) << "%)"
+	<< ", self cycles " << s.self_cycles
+	<< " (" << (100.0 * s.self_cycles / total) << "%)"
+	<< ", incl insns " << s.incl_insns
+	<< ", self insns " << s.self_insns
+	<< "\n";
+    std::vector<uint32_t> &ce = callees[f];
+    std::sort(ce.begin(), ce.end(), [&](uint32_t a, uint32_t b) {
+	return hotter(edges[a], entries[edge_ends[a].second],
+		      edges[b], entries[edge_ends[b].second]);
+      });
+    for(uint32_t e : ce) {
+      out << "\t-> " << std::hex << entries[edge_ends[e].second] << std::dec
+	  << ", calls " << edges[e].calls
+	  << ", incl cycles " << edges[e].incl_cycles
+	  << ", incl insns " << edges[e].incl_insns
+	  << "\n";
+    }
+  }
+  return out.good();
+}
@@ -0,0 +1,77 @@
+#ifndef __call_graph_hh__
+#define __call_graph_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "inst_record.hh"
+#include "pc_map.hh"
+#include "profile.hh"
+
+/* dynamic call graph : the retire trace is replayed against a shadow
+ * call stack. a jal or jalr that links pushes a frame for the
+ * function at its target, a jr through a link register pops back to
+ * the frame returning to its target (none when it matches no frame,
+ * e.g. returning out of the function the trace started in). every
+ * retired instruction costs its pc's average cycles per retire (tip
+ * over count) and is charged exclusively to the function on top of
+ * the stack, inclusively to each function and call edge on it */
+class call_graph {
+public:
+  struct stats {
+    uint64_t calls = 0;
+    uint64_t self_insns = 0, incl_insns = 0;
+    double self_cycles = 0.0, incl_cycles = 0.0;
+  };
+  /* deeper calls are counted but not pushed */
+  static const size_t max_depth = 1UL<<20;
+private:
+  static const uint32_t none = ~0U;
+  const pc_profile &prof;
+  struct frame {
+    uint32_t func, edge;
+    uint64_t ret_pc;
+    /* running totals when the frame was pushed */
+    uint64_t insns;
+    double cycles;
+  };
+  /* entry pc -> function id + 1 */
+  pc_map<uint32_t> index;
+  std::vector<uint64_t> entries;
+  std::vector<stats> funcs;
+  /* (caller << 32 | callee) -> edge id + 1 */
+  pc_map<uint32_t> edge_index;
+  std::vector<std::pair<uint32_t, uint32_t>> edge_ends;
+  std::vector<stats> edges;
+  /* activations on the stack, inclusive costs are taken when the
+   * outermost one is popped so recursion isn't counted twice */
+  std::vector<uint32_t> active, edge_active;
+  std::vector<frame> stack;
+  uint64_t insns = 0;
+  double cycles = 0.0;
+  bool pending = false;
+  inst_record last;
+  uint32_t func(uint64_t entry);
+  uint32_t edge(uint32_t caller, uint32_t callee);
+  void push(uint64_t entry, uint64_t ret_pc, bool call);
+  void pop();
+  void retire(const inst_record &ir, uint64_t npc, bool known);
+public:
+  call_graph(const pc_profile &prof) : prof(prof) {}
+  /* records in trace order, the first one's pc is the root function */
+  void add(const inst_record &ir);
+  /* retires the last record and unwinds the stack */
+  void finish();
+  size_t num_funcs() const {
+    return funcs.size();
+  }
+  size_t num_edges() const {
+    return edges.size();
+  }
+  /* functions by inclusive cycles, each followed by its callees */
+  bool write(const std::string &fname) const;
+};
+
+#endif
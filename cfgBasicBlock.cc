@@ -1,25 +1,13 @@
 #include <ostream>
 #include <fstream>
 #include <cassert>
+#include <algorithm>
 #include "regionCFG.hh"
 #include "helper.hh"
 #include "globals.hh"
 
-cfgBasicBlock::~cfgBasicBlock() {
-  std::set<ssaInsn*> ops;
-  for(size_t i = 0; i < insns.size(); i++) {
-    ops.insert(insns[i]);
-  }
-  for(size_t i = 0; i < phiNodes.size(); i++) {
-    ops.insert(phiNodes[i]);
-  }
-  for(size_t i = 0; i < ssaInsns.size(); i++) {
-    ops.insert(ssaInsns[i]);
-  }
-  for(ssaInsn *op : ops) {
-    delete op;
-  }
-}
+/* instructions and phis belong to the region's irArena */
+cfgBasicBlock::~cfgBasicBlock() {}
 
 void cfgBasicBlock::addWithInCFGEdges(regionCFG *cfg) {
   /* if this block has a branch, search if successor
@@ -103,25 +91,23 @@ void cfgBasicBlock::addWithInCFGEdges(regionCFG *cfg) {
 
 
 void cfgBasicBlock::addSuccessor(cfgBasicBlock *s) {
-  succs.insert(s);
-  s->preds.insert(this);
+  if(std::find(succs.begin(), succs.end(), s) != succs.end()) {
+    return;
+  }
+  succs.push_back(s);
+  s->preds.push_back(this);
 }
 
 void cfgBasicBlock::delSuccessor(cfgBasicBlock *s) {
-  std::set<cfgBasicBlock*>::iterator sit = succs.find(s);
-  succs.erase(sit);
-  sit = s->preds.find(this);
-  s->preds.erase(sit);
+  succs.erase(std::find(succs.begin(), succs.end(), s));
+  s->preds.erase(std::find(s->preds.begin(), s->preds.end(), this));
 }
 
 void cfgBasicBlock::addPhiNode(gprPhiNode *phi) {
   uint32_t r = phi->destRegister();
-  if(gprPhis[r])
-    delete phi;
-  else {
-    phiNodes.push_back(phi);
-    gprPhis[r] = phi;
-  }
+  assert(gprPhis[r] == nullptr);
+  phiNodes.push_back(phi);
+  gprPhis[r] = phi;
 }
 
 bool cfgBasicBlock::has_jal_jr_jalr() {
@@ -205,16 +191,14 @@ cfgBasicBlock::cfgBasicBlock(basicBlock *bb) :
   }
 }
 
+/* decodes once, a split hands the tail's instructions over */
 void cfgBasicBlock::bindInsns(regionCFG *cfg) {
   if(not(insns.empty())) {
-    for(size_t i = 0, n=insns.size(); i < n; i++) {
-      delete insns[i];
-    }
-    insns.clear();
+    return;
   }
-
+  insns.reserve(rawInsns.size());
   for(const auto & p : rawInsns) {
-    Insn *ins = getInsn(p.inst, p.pc);
+    Insn *ins = getInsn(p.inst, p.pc, cfg->irArena);
     assert(ins);
     ins->set(cfg,this);
     insns.push_back(ins);
@@ -253,9 +237,8 @@ void cfgBasicBlock::traverseAndRename(regionCFG *cfg){
   
   for(size_t i = 0; i < 32; i++) {
     if(cfg->allGprRead[i] or not(cfg->gprDefinitionBlocks[i].empty())) {
-      ssaInsn *op = new ssaInsn(i);
+      ssaInsn *op = cfg->irArena.make<ssaInsn>(i);
       regTbl.gprTbl[i] = op;
-      op->makePrettyName();          
       ssaInsns.push_back(op);
       //regTbl.loadGPR(i);
     }
@@ -287,7 +270,6 @@ void cfgBasicBlock::traverseAndRename(regionCFG *cfg, ssaRegTables prevRegTbl) {
   
   /* generate code for each instruction */
   for(auto p : phiNodes) {
-    p->makePrettyName();    
     ssaInsns.push_back(p);
     p->hookupRegs(regTbl);
   }
@@ -297,10 +279,7 @@ void cfgBasicBlock::traverseAndRename(regionCFG *cfg, ssaRegTables prevRegTbl) {
     insn->hookupRegs(regTbl);
   }
   
-  for(auto ins : insns) {
-    ins->makePrettyName();
-    ssaInsns.push_back(ins);
-  }
+  ssaInsns.insert(ssaInsns.end(), insns.begin(), insns.end());
   
   ssaRegTbl.copy(regTbl);
   
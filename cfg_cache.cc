@@ -0,0 +1,239 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sys/stat.h>
+
+#include "cfg_cache.hh"
+#include "columnar_trace.hh"
+#include "basicBlock.hh"
+#include "helper.hh"
+
+struct cfg_cache_block {
+  uint64_t entry, term;
+  uint32_t n_ins, n_succs;
+  uint64_t read_only;
+};
+
+struct cfg_cache_ins {
+  uint32_t inst, prof;
+  uint64_t pc, vpc;
+};
+
+struct cfg_cache_edge {
+  uint64_t src, dst, count;
+};
+
+template <typename T>
+static void write_section(std::ofstream &out, const std::vector<T> &v) {
+  out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <typename T>
+static bool read_section(std::ifstream &in, std::vector<T> &v, uint64_t n) {
+  v.resize(n);
+  in.read(reinterpret_cast<char*>(v.data()), n * sizeof(T));
+  return in.good();
+}
+
+/* size, mtime (ns) and inode of the trace, all zero if it can't be
+ * stat'ed */
+static void trace_ident(const std::string &trace, cfg_cache_header &h) {
+  struct stat s;
+  h.trace_size = h.trace_mtime = h.trace_ino = 0;
+  if(stat(trace.c_str(), &s) != 0) {
+    return;
+  }
+  h.trace_size = s.st_size;
+#ifdef __APPLE__
+  h.trace_mtime = s.st_mtimespec.tv_sec * 1000000000UL + s.st_mtimespec.tv_nsec;
+#else
+  h.trace_mtime = s.st_mtim.tv_sec * 1000000000UL + s.st_mtim.tv_nsec;
+#endif
+  h.trace_ino = s.st_ino;
+}
+
+/* crc of the whole trace, false if it can't be read */
+static bool trace_crc(const std::string &trace, uint64_t &crc) {
+  std::ifstream in(trace, std::ios::binary);
+  std::vector<uint8_t> buf(1UL<<20);
+  uint32_t c = ~0U;
+  while(in.good()) {
+    in.read(reinterpret_cast<char*>(buf.data()), buf.size());
+    c = update_crc(c, buf.data(), in.gcount());
+  }
+  crc = c ^ ~0U;
+  return in.eof();
+}
+
+uint64_t cfg_cache::key(const std::string &trace, const std::string &opts) {
+  std::ifstream in(trace, std::ios::binary);
+  in.seekg(0, std::ios::end);
+  uint64_t len = in.good() ? static_cast<uint64_t>(in.tellg()) : 0;
+  uint32_t c = update_crc(~0U, reinterpret_cast<uint8_t*>(&len), sizeof(len));
+  std::vector<uint8_t> buf(sample_len);
+  if(len <= (samples * sample_len)) {
+    in.seekg(0);
+    for(uint64_t offs = 0; offs < len; offs += sample_len) {
+      size_t n = std::min<uint64_t>(sample_len, len - offs);
+      in.read(reinterpret_cast<char*>(buf.data()), n);
+      c = update_crc(c, buf.data(), n);
+    }
+  }
+  else {
+    for(size_t s = 0; s < samples; s++) {
+      in.seekg(((len - sample_len) * s) / (samples - 1));
+      in.read(reinterpret_cast<char*>(buf.data()), sample_len);
+      c = update_crc(c, buf.data(), sample_len);
+    }
+  }
+  std::vector<uint8_t> o(opts.begin(), opts.end());
+  uint32_t oc = crc32(o.data(), o.size());
+  return (static_cast<uint64_t>(c ^ ~0U) << 32) | oc;
+}
+
+bool cfg_cache::write(const std::string &fname, uint64_t key,
+		      const std::string &trace,
+		      const pc_profile &prof,
+		      const std::map<int64_t, double> &tip,
+		      uint64_t start_pc, uint64_t trace_len) {
+  std::vector<uint64_t> pcs, counts, succs;
+  std::vector<cfg_cache_block> blocks;
+  std::vector<cfg_cache_ins> ins;
+  std::vector<cfg_cache_edge> edges;
+  std::vector<columnar_tip_entry> tips;
+  for(uint32_t i = 0, n = prof.size(); i < n; i++) {
+    pcs.push_back(prof.pc_at(i));
+    counts.push_back(prof.count_at(i));
+  }
+  for(const auto &p : basicBlock::bbMap.sorted()) {
+    const basicBlock *bb = p.second;
+    blocks.push_back(cfg_cache_block{bb->getEntryAddr(), bb->getTermAddr(),
+	  static_cast<uint32_t>(bb->getNumIns()),
+	  static_cast<uint32_t>(bb->getSuccs().size()),
+	  bb->isReadOnly()});
+    for(const auto &i : bb->getVecIns()) {
+      ins.push_back(cfg_cache_ins{i.inst, i.prof, i.pc, i.vpc});
+    }
+    for(const basicBlock *nbb : bb->getSuccs()) {
+      succs.push_back(nbb->getEntryAddr());
+    }
+  }
+  basicBlock::globalEdges.for_each([&edges](uint64_t src, uint64_t dst, uint64_t c) {
+      edges.push_back(cfg_cache_edge{src, dst, c});
+    });
+  for(const auto &p : tip) {
+    tips.push_back(columnar_tip_entry{p.first, p.second});
+  }
+
+  cfg_cache_header h;
+  memset(&h, 0, sizeof(h));
+  h.magic = magic;
+  h.version = version;
+  h.key = key;
+  trace_ident(trace, h);
+  if(not(trace_crc(trace, h.trace_crc))) {
+    return false;
+  }
+  h.start_pc = start_pc;
+  h.trace_len = trace_len;
+  h.n_pcs = pcs.size();
+  h.n_blocks = blocks.size();
+  h.n_ins = ins.size();
+  h.n_succs = succs.size();
+  h.n_edges = edges.size();
+  h.n_tip = tips.size();
+
+  /* written aside and renamed, a reader never sees half a cache */
+  const std::string tmp = fname + ".tmp";
+  std::ofstream out(tmp, std::ios::binary);
+  if(not(out.good())) {
+    return false;
+  }
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  write_section(out, pcs);
+  write_section(out, counts);
+  write_section(out, blocks);
+  write_section(out, ins);
+  write_section(out, succs);
+  write_section(out, edges);
+  write_section(out, tips);
+  out.close();
+  if(not(out.good())) {
+    return false;
+  }
+  return rename(tmp.c_str(), fname.c_str()) == 0;
+}
+
+bool cfg_cache::read(const std::string &fname, uint64_t key,
+		     const std::string &trace,
+		     pc_profile &prof,
+		     std::map<int64_t, double> &tip,
+		     uint64_t &start_pc, uint64_t &trace_len) {
+  std::ifstream in(fname, std::ios::binary);
+  cfg_cache_header h;
+  if(not(in.good())) {
+    return false;
+  }
+  in.read(reinterpret_cast<char*>(&h), sizeof(h));
+  if(not(in.good()) or (h.magic != magic) or (h.version != version) or (h.key != key)) {
+    return false;
+  }
+  cfg_cache_header t;
+  trace_ident(trace, t);
+  if((t.trace_size != h.trace_size) or (t.trace_mtime != h.trace_mtime) or
+     (t.trace_ino != h.trace_ino)) {
+    /* a copy or a touch of the same trace still matches */
+    if((t.trace_size != h.trace_size) or not(trace_crc(trace, t.trace_crc)) or
+       (t.trace_crc != h.trace_crc)) {
+      std::cout << fname << " was built from another version of " << trace << "\n";
+      return false;
+    }
+  }
+  std::vector<uint64_t> pcs, counts, succs;
+  std::vector<cfg_cache_block> blocks;
+  std::vector<cfg_cache_ins> ins;
+  std::vector<cfg_cache_edge> edges;
+  std::vector<columnar_tip_entry> tips;
+  if(not(read_section(in, pcs, h.n_pcs) and read_section(in, counts, h.n_pcs) and
+	 read_section(in, blocks, h.n_blocks) and read_section(in, ins, h.n_ins) and
+	 read_section(in, succs, h.n_succs) and read_section(in, edges, h.n_edges) and
+	 read_section(in, tips, h.n_tip))) {
+    std::cout << fname << " is truncated\n";
+    return false;
+  }
+
+  for(size_t i = 0; i < pcs.size(); i++) {
+    prof.retire(prof.add(pcs[i]), counts[i]);
+  }
+  size_t k = 0;
+  for(const cfg_cache_block &b : blocks) {
+    basicBlock *bb = new basicBlock(b.entry);
+    for(size_t e = k + b.n_ins; k < e; k++) {
+      bb->addIns(ins[k].inst, ins[k].pc, ins[k].vpc, ins[k].prof);
+    }
+    bb->setTermAddr(b.term);
+    if(b.read_only) {
+      bb->setReadOnly();
+    }
+  }
+  k = 0;
+  for(const cfg_cache_block &b : blocks) {
+    basicBlock *bb = basicBlock::globalFindBlock(b.entry);
+    for(size_t e = k + b.n_succs; k < e; k++) {
+      bb->addSuccessor(basicBlock::globalFindBlock(succs[k]));
+    }
+  }
+  basicBlock::globalEdges.reserve(basicBlock::globalEdges.size() + edges.size());
+  for(const cfg_cache_edge &e : edges) {
+    basicBlock::globalEdges(e.src, e.dst) += e.count;
+  }
+  for(const columnar_tip_entry &t : tips) {
+    tip[t.pc] = t.cycles;
+  }
+  start_pc = h.start_pc;
+  trace_len = h.trace_len;
+  return true;
+}
@@ -0,0 +1,71 @@
+#ifndef __cfg_cache_hh__
+#define __cfg_cache_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <map>
+
+#include "profile.hh"
+
+/* on-disk snapshot of a built CFG, so a re-run over the same trace
+ * (say with another pipe dump) skips decoding and buildCFG :
+ *   header | pc[n_pcs] | count[n_pcs] | block[n_blocks] |
+ *   instruction[n_ins] | succ[n_succs] | edge[n_edges] | tip[n_tip]
+ * blocks are in entry order, each followed in the instruction and
+ * succ sections by its own run of n_ins and n_succs entries */
+struct cfg_cache_header {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t key;
+  /* the trace file the cache was built from, and a crc of all of it */
+  uint64_t trace_size;
+  uint64_t trace_mtime;
+  uint64_t trace_ino;
+  uint64_t trace_crc;
+  uint64_t start_pc;
+  uint64_t trace_len;
+  uint64_t n_pcs;
+  uint64_t n_blocks;
+  uint64_t n_ins;
+  uint64_t n_succs;
+  uint64_t n_edges;
+  uint64_t n_tip;
+};
+
+class cfg_cache {
+public:
+  static const uint64_t magic = 0x6863616334367672UL;
+  static const uint64_t version = 3;
+  /* number and size (bytes) of the trace samples hashed */
+  static const size_t samples = 64;
+  static const size_t sample_len = 1UL<<16;
+  /* crc of the trace's size and content in the high half, crc of
+   * the options that shape the CFG (pruning etc) in the low half.
+   * traces bigger than samples*sample_len are hashed by evenly
+   * spaced samples (first and last bytes included) : reading all
+   * of a many GB trace would cost more than the build it saves. a
+   * trace rewritten outside the samples keeps its key, so the cache
+   * also records the trace's size, mtime and inode. when they differ
+   * (a copy, a touch or a rewrite) the trace's content is checked
+   * against a crc of all of it made when the cache was written */
+  static uint64_t key(const std::string &trace, const std::string &opts);
+  /* saves the blocks in basicBlock::bbMap, their edge profile, prof
+   * and tip, built from trace */
+  static bool write(const std::string &fname, uint64_t key,
+		    const std::string &trace,
+		    const pc_profile &prof,
+		    const std::map<int64_t, double> &tip,
+		    uint64_t start_pc, uint64_t trace_len);
+  /* false, having built nothing, unless fname holds a cache for key
+   * built from a trace with the content trace has now. otherwise the blocks,
+   * basicBlock::globalEdges, prof and tip are as they were when it
+   * was written */
+  static bool read(const std::string &fname, uint64_t key,
+		   const std::string &trace,
+		   pc_profile &prof,
+		   std::map<int64_t, double> &tip,
+		   uint64_t &start_pc, uint64_t &trace_len);
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __cfg_graph_hh__
+#define __cfg_graph_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+/* block adjacency over dense block ids in compressed sparse row
+ * form : the successors of v are sdst[soff[v]] .. sdst[soff[v+1]-1]
+ * (likewise for predecessors), so a pass over the graph walks a few
+ * flat arrays and keeps its own per block state in vectors indexed
+ * by id instead of in maps keyed by block pointers */
+class cfg_graph {
+public:
+  struct range {
+    const uint32_t *b, *e;
+    const uint32_t *begin() const {
+      return b;
+    }
+    const uint32_t *end() const {
+      return e;
+    }
+    size_t size() const {
+      return e - b;
+    }
+    bool empty() const {
+      return b == e;
+    }
+  };
+private:
+  std::vector<uint32_t> soff, sdst, poff, pdst;
+  static range row(const std::vector<uint32_t> &off,
+		   const std::vector<uint32_t> &dst, uint32_t v) {
+    return range{dst.data() + off[v], dst.data() + off[v+1]};
+  }
+public:
+  size_t size() const {
+    return soff.empty() ? 0 : (soff.size() - 1);
+  }
+  size_t numEdges() const {
+    return sdst.size();
+  }
+  /* edges are (src, dst) pairs of ids below n sorted by src then
+   * dst, so both successor and predecessor rows come out sorted */
+  void build(size_t n, const std::vector<std::pair<uint32_t, uint32_t>> &edges) {
+    soff.assign(n + 1, 0);
+    poff.assign(n + 1, 0);
+    sdst.resize(edges.size());
+    pdst.resize(edges.size());
+    for(const auto &e : edges) {
+      soff[e.first + 1]++;
+      poff[e.second + 1]++;
+    }
+    for(size_t v = 0; v < n; v++) {
+      soff[v + 1] += soff[v];
+      poff[v + 1] += poff[v];
+    }
+    std::vector<uint32_t> pfill(poff.begin(), poff.end() - 1);
+    for(size_t i = 0, ne = edges.size(); i < ne; i++) {
+      sdst[i] = edges[i].second;
+      pdst[pfill[edges[i].second]++] = edges[i].first;
+    }
+  }
+  range succs(uint32_t v) const {
+    return row(soff, sdst, v);
+  }
+  range preds(uint32_t v) const {
+    return row(poff, pdst, v);
+  }
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include <iostream>
+#include <thread>
+#include <numeric>
+#include <algorithm>
+
+#include "cfg_shard.hh"
+#include "basicBlock.hh"
+#include "globals.hh"
+
+void cfg_shard::fill(std::vector<cfg_shard> &shards,
+		     const std::function<void(size_t, cfg_shard &)> &f) {
+  std::vector<std::thread> workers;
+  for(size_t s = 0; s < shards.size(); s++) {
+    workers.emplace_back(f, s, std::ref(shards[s]));
+  }
+  for(std::thread &t : workers) {
+    t.join();
+  }
+}
+
+/* in a regular trace every retired pc is either a leader (the first
+ * pc or the target of a block ending inst) or falls through from
+ * pc-4, so the sequential walk's blocks are the runs of retired pcs
+ * cut at leaders and after block ending insts, and its edges are
+ * the retired transitions from a block's last inst to a leader.
+ * the one exception is the block the walk is still building when
+ * the trace ends : not read only, no terminal address and no edge
+ * to a block it falls into, as that edge is only added once the
+ * next record is processed */
+bool cfg_shard::build(const std::vector<cfg_shard> &shards, uint64_t start_pc,
+		      pc_profile &prof) {
+  auto irregular = []() {
+    std::cout << "trace can't be sharded, building the CFG sequentially\n";
+    return false;
+  };
+  const cfg_shard *tail = nullptr;
+  for(const cfg_shard &s : shards) {
+    if(not(s.regular)) {
+      return irregular();
+    }
+    if(not(s.pcs.empty())) {
+      tail = &s;
+    }
+  }
+  if(tail == nullptr) {
+    return irregular();
+  }
+
+  pc_profile p;
+  std::vector<first_retire> firsts;
+  edge_map e;
+  pc_map<uint8_t> l;
+  l[start_pc] = 1;
+  size_t ne = 0;
+  for(const cfg_shard &s : shards) {
+    ne += s.edges.size();
+  }
+  e.reserve(ne);
+  for(const cfg_shard &s : shards) {
+    for(size_t i = 0, n = s.pcs.size(); i < n; i++) {
+      uint32_t g = p.add(s.pcs[i].pc);
+      if(g == firsts.size()) {
+	firsts.push_back(s.pcs[i]);
+      }
+      else if(firsts[g].inst != s.pcs[i].inst) {
+	return irregular();
+      }
+      p.retire(g, s.scaled(s.counts[i]));
+    }
+    s.edges.for_each([&e, &s](uint64_t src, uint64_t dst, uint64_t c) {
+	e(src, dst) += s.scaled(c);
+      });
+    for(const auto &x : s.leaders) {
+      l[x.first] = 1;
+    }
+  }
+
+  /* cut the retired pcs into blocks before touching any global state */
+  std::vector<uint32_t> order(firsts.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&firsts](uint32_t a, uint32_t b) {
+      return firsts[a].pc < firsts[b].pc;
+    });
+  std::vector<size_t> starts;
+  for(size_t k = 0, n = order.size(); k < n; k++) {
+    const first_retire &f = firsts[order[k]];
+    bool cut = (k == 0) or (l.find(f.pc) != nullptr);
+    if(not(cut)) {
+      const first_retire &pf = firsts[order[k-1]];
+      cut = (pf.pc != (f.pc - 4)) or ends_block(pf.inst);
+    }
+    if(cut) {
+      if(l.find(f.pc) == nullptr) {
+	return irregular();
+      }
+      starts.push_back(k);
+    }
+  }
+  starts.push_back(order.size());
+
+  std::vector<basicBlock*> bbs;
+  for(size_t b = 0; (b + 1) < starts.size(); b++) {
+    basicBlock *bb = new basicBlock(firsts[order[starts[b]]].pc);
+    for(size_t k = starts[b]; k < starts[b+1]; k++) {
+      const first_retire &f = firsts[order[k]];
+      bb->addIns(f.inst, f.pc, f.vpc, order[k]);
+    }
+    bbs.push_back(bb);
+  }
+  /* leaders never retired (the last record's pc) are empty blocks */
+  for(const auto &x : l) {
+    if(basicBlock::globalFindBlock(x.first) == nullptr) {
+      new basicBlock(x.first);
+    }
+  }
+
+  /* the block of the last retired record is still being built if
+   * the walk entered it once and never left */
+  basicBlock *open = basicBlock::bbInBlock(tail->last_pc);
+  uint32_t li = p.find(tail->last_pc);
+  if(ends_block(firsts[li].inst) or (p.count(open->getEntryAddr()) != 1)) {
+    open = nullptr;
+  }
+  for(basicBlock *bb : bbs) {
+    if(bb != open) {
+      bb->setTermAddr(bb->getVecIns().back().pc);
+      bb->setReadOnly();
+    }
+  }
+
+  e.for_each([open](uint64_t src, uint64_t dst, uint64_t c) {
+      basicBlock *d = basicBlock::globalFindBlock(dst);
+      basicBlock *s = basicBlock::bbInBlock(src);
+      if((d == nullptr) or (s == open) or (s->getVecIns().back().pc != src)) {
+	return;
+      }
+      s->addSuccessor(d);
+    });
+
+  if(open) {
+    globals::cBB = open;
+  }
+  else {
+    basicBlock *d = basicBlock::globalFindBlock(tail->next_pc);
+    basicBlock *s = basicBlock::bbInBlock(tail->last_pc);
+    globals::cBB = (d and (s->getVecIns().back().pc == tail->last_pc)) ? d : s;
+  }
+  basicBlock::globalEdges = std::move(e);
+  prof = std::move(p);
+  return true;
+}
+
+void cfg_shard::reduce(const std::vector<cfg_shard> &shards, pc_profile &prof) {
+  pc_profile p;
+  edge_map e;
+  size_t ne = 0;
+  for(uint32_t i = 0, n = prof.size(); i < n; i++) {
+    p.add(prof.pc_at(i));
+  }
+  for(const cfg_shard &s : shards) {
+    ne += s.edges.size();
+  }
+  e.reserve(ne);
+  for(const cfg_shard &s : shards) {
+    for(size_t i = 0, n = s.pcs.size(); i < n; i++) {
+      p.retire(p.add(s.pcs[i].pc), s.scaled(s.counts[i]));
+    }
+    s.edges.for_each([&e, &s](uint64_t src, uint64_t dst, uint64_t c) {
+	e(src, dst) += s.scaled(c);
+      });
+  }
+  basicBlock::globalEdges = std::move(e);
+  prof = std::move(p);
+}
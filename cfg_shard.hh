@@ -0,0 +1,130 @@
+#ifndef __cfg_shard_hh__
+#define __cfg_shard_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <functional>
+
+#include "inst_record.hh"
+#include "pc_map.hh"
+#include "profile.hh"
+
+/* true when inst ends the basic block being built */
+inline bool ends_block(uint32_t inst) {
+  uint32_t opcode = inst & 127;
+  switch(opcode)
+    {
+      //imm[11:0] rs1 000 rd 1100111 JALR
+    case 0x67:
+      //imm[20|10:1|11|19:12] rd 1101111 JAL
+    case 0x6f:
+    case 0x63: /* cond branch */
+      return true;
+    case 0x73: { /* system instructions */
+      uint32_t csr_id = (inst>>20);
+      bool is_ecall = ((inst >> 7) == 0);
+      bool is_ebreak = ((inst>>7) == 0x2000);
+      bool bits19to7z = (((inst >> 7) & 8191) == 0);
+      uint64_t upper7 = (inst>>25);
+      if(is_ecall) {
+	return true;
+      }
+      else if(upper7 == 9 && ((inst & (16384-1)) == 0x73 )) { /* sfence */
+	return false;
+      }
+      else if(bits19to7z and (csr_id == 0x105)) {  /* wfi */
+	return false;
+      }
+      else if(bits19to7z and (csr_id == 0x002)) {  /* uret */
+	return true;
+      }
+      else if(bits19to7z and (csr_id == 0x102)) {  /* sret */
+	return true;
+      }
+      else if(bits19to7z and (csr_id == 0x202)) { /* hret */
+	return true;
+      }
+      else if(bits19to7z and (csr_id == 0x302)) {  /* mret */
+	return true;
+      }
+      return is_ebreak;
+    }
+    default:
+      return false;
+    }
+}
+
+/* what one thread learns from a contiguous slice of a trace (or
+ * from a whole trace when several are aggregated) :
+ * per pc counts, (pc, npc) counts and the pcs control flow lands
+ * on (block leaders). pcs are indexed in the order the slice first
+ * retires them so the merge can reproduce the global first-retire
+ * order the sequential walk hands out profile indices in */
+class cfg_shard {
+private:
+  struct first_retire {
+    uint64_t pc, vpc;
+    uint32_t inst;
+  };
+  pc_map<uint32_t> index;
+  std::vector<first_retire> pcs;
+  std::vector<uint64_t> counts;
+  edge_map edges;
+  pc_map<uint8_t> leaders;
+  /* last record retired and the pc after it */
+  uint64_t last_pc = 0, next_pc = 0;
+  /* false once the slice has something the leader rules can't
+   * reproduce : a fall through that isn't to pc+4, or a pc whose
+   * inst word changes */
+  bool regular = true;
+  /* counts and edges are scaled by this when merged */
+  double weight = 1.0;
+  uint64_t scaled(uint64_t c) const {
+    return (weight == 1.0) ? c : static_cast<uint64_t>(std::llround(c * weight));
+  }
+public:
+  void set_weight(double w) {
+    weight = w;
+  }
+  /* pc starts a block even if nothing in the slice jumps to it */
+  void lead(uint64_t pc) {
+    leaders[pc] = 1;
+  }
+  void retire(const inst_record &ir, uint64_t npc) {
+    uint32_t &e = index[ir.pc];
+    if(e == 0) {
+      pcs.push_back(first_retire{ir.pc, ir.vpc, ir.inst});
+      counts.push_back(0);
+      e = pcs.size();
+    }
+    else if(pcs[e-1].inst != ir.inst) {
+      regular = false;
+    }
+    counts[e-1]++;
+    edges(ir.pc, npc)++;
+    if(ends_block(ir.inst)) {
+      leaders[npc] = 1;
+    }
+    else if(npc != (ir.pc + 4)) {
+      regular = false;
+    }
+    last_pc = ir.pc;
+    next_pc = npc;
+  }
+  /* runs f(s, shards[s]) for every shard on a thread of its own */
+  static void fill(std::vector<cfg_shard> &shards,
+		   const std::function<void(size_t, cfg_shard &)> &f);
+  /* merges the shards (in trace order) into the blocks, edges and
+   * profile the sequential walk from start_pc would have built.
+   * returns false, having built nothing, when a shard isn't regular */
+  static bool build(const std::vector<cfg_shard> &shards, uint64_t start_pc,
+		    pc_profile &prof);
+  /* for blocks some other walk built over the shards' records :
+   * replaces prof's counts and basicBlock::globalEdges by the shards'
+   * (weighted) sums, keeping prof's indices */
+  static void reduce(const std::vector<cfg_shard> &shards, pc_profile &prof);
+};
+
+#endif
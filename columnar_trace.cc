@@ -0,0 +1,159 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "columnar_trace.hh"
+
+static uint64_t round_up(uint64_t x) {
+  return (x + columnar_trace::align - 1) & ~(columnar_trace::align - 1);
+}
+
+template <typename T>
+static void write_column(std::ofstream &out, uint64_t &pos, const std::vector<T> &v) {
+  out.seekp(pos);
+  out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+  pos += v.size() * sizeof(T);
+}
+
+bool columnar_trace::is_columnar(const std::string &fname) {
+  uint64_t m = 0;
+  std::ifstream in(fname, std::ios::binary);
+  if(not(in.good())) {
+    return false;
+  }
+  in.read(reinterpret_cast<char*>(&m), sizeof(m));
+  return in.good() and (m == magic);
+}
+
+bool columnar_trace::write(const std::string &fname, trace_reader &tr) {
+  columnar_trace_header h;
+  memset(&h, 0, sizeof(h));
+  std::ofstream out(fname, std::ios::binary);
+  if(not(out.good())) {
+    return false;
+  }
+  /* header is rewritten once the sizes are known */
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+  /* every column streams to its own section, laid out from the
+   * record count the reader knows up front */
+  uint64_t n = 0;
+  if(not(tr.size(n))) {
+    std::cerr << "can't lay out a columnar trace without the record count\n";
+    return false;
+  }
+  h.pc_offs = round_up(sizeof(h));
+  h.vpc_offs = round_up(h.pc_offs + n*sizeof(uint64_t));
+  h.inst_offs = round_up(h.vpc_offs + n*sizeof(uint64_t));
+  uint64_t pc_pos = h.pc_offs, vpc_pos = h.vpc_offs, inst_pos = h.inst_offs;
+
+  std::vector<uint64_t> pc, vpc;
+  std::vector<uint32_t> inst;
+  std::vector<inst_record> chunk;
+  uint64_t m = 0;
+  while(tr.read(chunk, 1UL<<16) != 0) {
+    for(const inst_record &r : chunk) {
+      pc.push_back(r.pc);
+      vpc.push_back(r.vpc);
+      inst.push_back(r.inst);
+    }
+    m += chunk.size();
+    if(m > n) {
+      break;
+    }
+    write_column(out, pc_pos, pc);
+    write_column(out, vpc_pos, vpc);
+    write_column(out, inst_pos, inst);
+    pc.clear();
+    vpc.clear();
+    inst.clear();
+    chunk.clear();
+  }
+  if(m != n) {
+    std::cerr << "trace holds " << m << " records, not the " << n << " it says\n";
+    return false;
+  }
+
+  std::vector<columnar_tip_entry> tip;
+  for(const auto &p : tr.get_tip()) {
+    tip.push_back(columnar_tip_entry{p.first, p.second});
+  }
+  h.magic = magic;
+  h.version = version;
+  h.n_records = n;
+  h.n_tip = tip.size();
+  h.tip_offs = round_up(h.inst_offs + n*sizeof(uint32_t));
+  uint64_t tip_pos = h.tip_offs;
+  write_column(out, tip_pos, tip);
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  return out.good();
+}
+
+columnar_trace::columnar_trace(const std::string &fname) {
+  struct stat s;
+  fd = open(fname.c_str(), O_RDONLY);
+  if(fd == -1 or fstat(fd, &s) != 0) {
+    std::cerr << "unable to open columnar trace " << fname << "\n";
+    exit(-1);
+  }
+  len = s.st_size;
+  if(len < sizeof(columnar_trace_header)) {
+    std::cerr << fname << " is too small to be a columnar trace\n";
+    exit(-1);
+  }
+  void *p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(p == MAP_FAILED) {
+    std::cerr << "unable to mmap " << fname << "\n";
+    exit(-1);
+  }
+  buf = reinterpret_cast<uint8_t*>(p);
+  /* we walk the trace front to back */
+  madvise(buf, len, MADV_SEQUENTIAL);
+
+  hdr = reinterpret_cast<const columnar_trace_header*>(buf);
+  if(hdr->magic != magic or hdr->version != version) {
+    std::cerr << fname << " has bad columnar trace header\n";
+    exit(-1);
+  }
+  auto fits = [this](uint64_t offs, uint64_t n, uint64_t sz) {
+    return (offs <= len) and (n <= ((len - offs) / sz));
+  };
+  const uint64_t n = hdr->n_records;
+  if((hdr->pc_offs & 7) or (hdr->vpc_offs & 7) or (hdr->inst_offs & 3) or
+     (hdr->tip_offs & 7) or
+     not(fits(hdr->pc_offs, n, sizeof(uint64_t))) or
+     not(fits(hdr->vpc_offs, n, sizeof(uint64_t))) or
+     not(fits(hdr->inst_offs, n, sizeof(uint32_t))) or
+     not(fits(hdr->tip_offs, hdr->n_tip, sizeof(columnar_tip_entry)))) {
+    std::cerr << fname << " is truncated or has a bad header\n";
+    exit(-1);
+  }
+  pcs = reinterpret_cast<const uint64_t*>(buf + hdr->pc_offs);
+  vpcs = reinterpret_cast<const uint64_t*>(buf + hdr->vpc_offs);
+  insts = reinterpret_cast<const uint32_t*>(buf + hdr->inst_offs);
+  tips = reinterpret_cast<const columnar_tip_entry*>(buf + hdr->tip_offs);
+}
+
+columnar_trace::~columnar_trace() {
+  if(buf) {
+    munmap(buf, len);
+  }
+  if(fd != -1) {
+    close(fd);
+  }
+}
+
+void columnar_trace::get_tip(std::map<int64_t, double> &tip) const {
+  for(size_t i = 0, n = hdr->n_tip; i < n; i++) {
+    tip[tips[i].pc] = tips[i].cycles;
+  }
+}
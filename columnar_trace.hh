@@ -0,0 +1,194 @@
+#ifndef __columnar_trace_hh__
+#define __columnar_trace_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <map>
+#include <iterator>
+#include <algorithm>
+
+#include "inst_record.hh"
+#include "trace_reader.hh"
+
+/* on-disk columnar retire trace:
+ *   header | pc[n] | vpc[n] | inst[n] | tip[n_tip]
+ * every section starts on a page boundary so the
+ * reader can mmap the file and walk the columns in place */
+struct columnar_trace_header {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t n_records;
+  uint64_t n_tip;
+  uint64_t pc_offs;
+  uint64_t vpc_offs;
+  uint64_t inst_offs;
+  uint64_t tip_offs;
+};
+
+struct columnar_tip_entry {
+  int64_t pc;
+  double cycles;
+};
+
+class columnar_trace {
+public:
+  static const uint64_t magic = 0x746c6f6334367672UL;
+  static const uint64_t version = 1;
+  static const uint64_t align = 4096;
+private:
+  int fd = -1;
+  uint8_t *buf = nullptr;
+  size_t len = 0;
+  const columnar_trace_header *hdr = nullptr;
+  const uint64_t *pcs = nullptr;
+  const uint64_t *vpcs = nullptr;
+  const uint32_t *insts = nullptr;
+  const columnar_tip_entry *tips = nullptr;
+public:
+  class const_iterator {
+  private:
+    const columnar_trace *t;
+    size_t i;
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef inst_record value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const inst_record *pointer;
+    typedef inst_record reference;
+    /* records are built on the fly, -> hands out a copy */
+    struct arrow {
+      inst_record r;
+      const inst_record *operator->() const {
+	return &r;
+      }
+    };
+    const_iterator(const columnar_trace *t, size_t i) : t(t), i(i) {}
+    inst_record operator*() const {
+      return t->at(i);
+    }
+    arrow operator->() const {
+      return arrow{t->at(i)};
+    }
+    inst_record operator[](difference_type d) const {
+      return t->at(i + d);
+    }
+    const_iterator &operator++() {
+      ++i;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator c = *this;
+      ++i;
+      return c;
+    }
+    const_iterator &operator--() {
+      --i;
+      return *this;
+    }
+    const_iterator operator--(int) {
+      const_iterator c = *this;
+      --i;
+      return c;
+    }
+    const_iterator operator+(difference_type d) const {
+      return const_iterator(t, i + d);
+    }
+    friend const_iterator operator+(difference_type d, const const_iterator &it) {
+      return it + d;
+    }
+    const_iterator operator-(difference_type d) const {
+      return const_iterator(t, i - d);
+    }
+    const_iterator &operator+=(difference_type d) {
+      i += d;
+      return *this;
+    }
+    const_iterator &operator-=(difference_type d) {
+      i -= d;
+      return *this;
+    }
+    difference_type operator-(const const_iterator &o) const {
+      return static_cast<difference_type>(i) - static_cast<difference_type>(o.i);
+    }
+    bool operator==(const const_iterator &o) const {
+      return i == o.i;
+    }
+    bool operator!=(const const_iterator &o) const {
+      return i != o.i;
+    }
+    bool operator<(const const_iterator &o) const {
+      return i < o.i;
+    }
+    bool operator>(const const_iterator &o) const {
+      return i > o.i;
+    }
+    bool operator<=(const const_iterator &o) const {
+      return i <= o.i;
+    }
+    bool operator>=(const const_iterator &o) const {
+      return i >= o.i;
+    }
+  };
+
+  columnar_trace(const std::string &fname);
+  ~columnar_trace();
+  columnar_trace(const columnar_trace &) = delete;
+  columnar_trace &operator=(const columnar_trace &) = delete;
+
+  static bool is_columnar(const std::string &fname);
+  static bool write(const std::string &fname, trace_reader &tr);
+
+  size_t size() const {
+    return hdr->n_records;
+  }
+  bool empty() const {
+    return size() == 0;
+  }
+  uint64_t pc(size_t i) const {
+    return pcs[i];
+  }
+  uint64_t vpc(size_t i) const {
+    return vpcs[i];
+  }
+  uint32_t inst(size_t i) const {
+    return insts[i];
+  }
+  inst_record at(size_t i) const {
+    return inst_record(pcs[i], vpcs[i], insts[i]);
+  }
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+  const_iterator end() const {
+    return const_iterator(this, size());
+  }
+  void get_tip(std::map<int64_t, double> &tip) const;
+};
+
+class columnar_trace_reader : public trace_reader {
+private:
+  columnar_trace ct;
+  size_t pos = 0;
+  std::map<int64_t, double> tip;
+public:
+  columnar_trace_reader(const std::string &fname) : ct(fname) {
+    ct.get_tip(tip);
+  }
+  size_t read(std::vector<inst_record> &chunk, size_t max) override {
+    size_t n = std::min(max, ct.size() - pos);
+    for(size_t i = 0; i < n; i++) {
+      chunk.push_back(ct.at(pos++));
+    }
+    return n;
+  }
+  const std::map<int64_t, double> &get_tip() const override {
+    return tip;
+  }
+  bool size(uint64_t &n) const override {
+    n = ct.size();
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,362 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "compressed_trace.hh"
+#include "helper.hh"
+
+static void pad_to_word(std::ofstream &out, uint64_t &offs) {
+  while(offs & 7) {
+    out.put(0);
+    offs++;
+  }
+}
+
+bool compressed_trace::is_compressed(const std::string &fname) {
+  uint64_t m = 0;
+  std::ifstream in(fname, std::ios::binary);
+  if(not(in.good())) {
+    return false;
+  }
+  in.read(reinterpret_cast<char*>(&m), sizeof(m));
+  return in.good() and (m == magic);
+}
+
+bool compressed_trace::write(const std::string &fname, trace_reader &tr, uint64_t block_size) {
+  compressed_trace_header h;
+  memset(&h, 0, sizeof(h));
+  std::ofstream out(fname, std::ios::binary);
+  if(not(out.good()) or (block_size == 0)) {
+    return false;
+  }
+  /* header is rewritten once the sizes are known */
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  uint64_t offs = sizeof(h);
+
+  std::vector<uint64_t> index;
+  std::vector<compressed_inst_entry> inst_tab;
+  std::unordered_map<uint64_t, uint32_t> inst_map;
+  std::vector<uint8_t> blk;
+  std::vector<inst_record> chunk;
+  uint64_t n = 0, prev_pc = 0;
+  int64_t prev_voffs = 0;
+
+  auto flush = [&]() {
+    out.write(reinterpret_cast<const char*>(blk.data()), blk.size());
+    offs += blk.size();
+    blk.clear();
+  };
+
+  while(tr.read(chunk, block_size) != 0) {
+    for(const inst_record &r : chunk) {
+      if((n % block_size) == 0) {
+	flush();
+	index.push_back(offs);
+	prev_pc = 0;
+	prev_voffs = 0;
+      }
+      auto it = inst_map.find(r.pc);
+      if(it == inst_map.end()) {
+	inst_map[r.pc] = r.inst;
+	inst_tab.push_back(compressed_inst_entry{r.pc, r.inst});
+      }
+      uint64_t flags = 0;
+      int64_t voffs = static_cast<int64_t>(r.vpc - r.pc);
+      uint64_t zz = zigzag(static_cast<int64_t>(r.pc - prev_pc - 4));
+      if(voffs != prev_voffs) {
+	flags |= vpc_flag;
+      }
+      if(it != inst_map.end() and it->second != r.inst) {
+	flags |= inst_flag;
+      }
+      if(zz >> (64 - flag_bits)) {
+	flags |= abs_pc_flag;
+	put_varint(blk, flags);
+	put_varint(blk, r.pc);
+      }
+      else {
+	put_varint(blk, (zz << flag_bits) | flags);
+      }
+      if(flags & vpc_flag) {
+	put_varint(blk, zigzag(voffs - prev_voffs));
+      }
+      if(flags & inst_flag) {
+	put_varint(blk, r.inst);
+      }
+      prev_pc = r.pc;
+      prev_voffs = voffs;
+      n++;
+    }
+    chunk.clear();
+  }
+  flush();
+  pad_to_word(out, offs);
+
+  h.magic = magic;
+  h.version = version;
+  h.n_records = n;
+  h.block_size = block_size;
+  h.n_blocks = index.size();
+  index.push_back(offs);
+  h.index_offs = offs;
+  out.write(reinterpret_cast<const char*>(index.data()), index.size()*sizeof(uint64_t));
+  offs += index.size()*sizeof(uint64_t);
+
+  std::sort(inst_tab.begin(), inst_tab.end(),
+	    [](const compressed_inst_entry &a, const compressed_inst_entry &b) {
+	      return a.pc < b.pc;
+	    });
+  h.n_insts = inst_tab.size();
+  h.insts_offs = offs;
+  out.write(reinterpret_cast<const char*>(inst_tab.data()), inst_tab.size()*sizeof(compressed_inst_entry));
+  offs += inst_tab.size()*sizeof(compressed_inst_entry);
+
+  h.n_tip = tr.get_tip().size();
+  h.tip_offs = offs;
+  for(const auto &p : tr.get_tip()) {
+    out.write(reinterpret_cast<const char*>(&p.first), sizeof(p.first));
+    out.write(reinterpret_cast<const char*>(&p.second), sizeof(p.second));
+  }
+
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  return out.good();
+}
+
+compressed_trace::compressed_trace(const std::string &fname) {
+  struct stat s;
+  fd = open(fname.c_str(), O_RDONLY);
+  if(fd == -1 or fstat(fd, &s) != 0) {
+    std::cerr << "unable to open compressed trace " << fname << "\n";
+    exit(-1);
+  }
+  len = s.st_size;
+  if(len < sizeof(compressed_trace_header)) {
+    std::cerr << fname << " is too small to be a compressed trace\n";
+    exit(-1);
+  }
+  void *p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(p == MAP_FAILED) {
+    std::cerr << "unable to mmap " << fname << "\n";
+    exit(-1);
+  }
+  buf = reinterpret_cast<uint8_t*>(p);
+  hdr = reinterpret_cast<const compressed_trace_header*>(buf);
+  if(hdr->magic != magic or hdr->version != version) {
+    std::cerr << fname << " has bad compressed trace header\n";
+    exit(-1);
+  }
+  /* n entries of sz bytes at offs lie inside the file */
+  auto fits = [this](uint64_t offs, uint64_t n, uint64_t sz) {
+    return (offs <= len) and (n <= ((len - offs) / sz));
+  };
+  const uint64_t bs = hdr->block_size, nr = hdr->n_records;
+  if((bs == 0) or (hdr->n_blocks != ((nr / bs) + ((nr % bs) != 0))) or
+     (hdr->index_offs & 7) or (hdr->insts_offs & 7) or
+     not(fits(hdr->index_offs, hdr->n_blocks, sizeof(uint64_t))) or
+     not(fits(hdr->index_offs + hdr->n_blocks*sizeof(uint64_t), 1, sizeof(uint64_t))) or
+     not(fits(hdr->insts_offs, hdr->n_insts, sizeof(compressed_inst_entry))) or
+     not(fits(hdr->tip_offs, hdr->n_tip, sizeof(int64_t)+sizeof(double)))) {
+    std::cerr << fname << " is truncated or has a bad header\n";
+    exit(-1);
+  }
+  index = reinterpret_cast<const uint64_t*>(buf + hdr->index_offs);
+  /* blocks lie in order between the header and the index */
+  if((index[0] < sizeof(compressed_trace_header)) or
+     (index[hdr->n_blocks] > hdr->index_offs)) {
+    std::cerr << fname << " has a bad block index\n";
+    exit(-1);
+  }
+  for(size_t b = 0; b < hdr->n_blocks; b++) {
+    if(index[b] > index[b+1]) {
+      std::cerr << fname << " has a bad block index\n";
+      exit(-1);
+    }
+  }
+  const compressed_inst_entry *e =
+    reinterpret_cast<const compressed_inst_entry*>(buf + hdr->insts_offs);
+  insts.reserve(hdr->n_insts);
+  for(size_t i = 0; i < hdr->n_insts; i++) {
+    insts[e[i].pc] = static_cast<uint32_t>(e[i].inst);
+  }
+}
+
+compressed_trace::~compressed_trace() {
+  if(buf) {
+    munmap(buf, len);
+  }
+  if(fd != -1) {
+    close(fd);
+  }
+}
+
+static void corrupt_block(size_t b) {
+  std::cerr << "compressed trace block " << b << " is corrupt\n";
+  exit(-1);
+}
+
+void compressed_trace::decode_block(size_t b, std::vector<inst_record> &out) const {
+  const uint8_t *p = buf + index[b], *e = buf + index[b+1];
+  size_t n = std::min(hdr->block_size, hdr->n_records - b*hdr->block_size);
+  uint64_t pc = 0, w = 0, x = 0;
+  int64_t voffs = 0;
+  for(size_t i = 0; i < n; i++) {
+    if(not(get_varint(p, e, w))) {
+      corrupt_block(b);
+    }
+    uint64_t flags = w & ((1UL << flag_bits) - 1);
+    if(flags & abs_pc_flag) {
+      if(not(get_varint(p, e, pc))) {
+	corrupt_block(b);
+      }
+    }
+    else {
+      pc += unzigzag(w >> flag_bits) + 4;
+    }
+    if(flags & vpc_flag) {
+      if(not(get_varint(p, e, x))) {
+	corrupt_block(b);
+      }
+      voffs += unzigzag(x);
+    }
+    uint32_t inst;
+    if(flags & inst_flag) {
+      if(not(get_varint(p, e, x))) {
+	corrupt_block(b);
+      }
+      inst = x;
+    }
+    else {
+      auto it = insts.find(pc);
+      if(it == insts.end()) {
+	corrupt_block(b);
+      }
+      inst = it->second;
+    }
+    out.emplace_back(pc, pc + voffs, inst);
+  }
+}
+
+uint64_t compressed_trace::block_pc(size_t b) const {
+  const uint8_t *p = buf + index[b], *e = buf + index[b+1];
+  uint64_t w = 0, pc = 0;
+  if(not(get_varint(p, e, w))) {
+    corrupt_block(b);
+  }
+  if(w & abs_pc_flag) {
+    if(not(get_varint(p, e, pc))) {
+      corrupt_block(b);
+    }
+    return pc;
+  }
+  return unzigzag(w >> flag_bits) + 4;
+}
+
+void compressed_trace::get_tip(std::map<int64_t, double> &tip) const {
+  const uint8_t *p = buf + hdr->tip_offs;
+  for(size_t i = 0; i < hdr->n_tip; i++) {
+    int64_t pc;
+    double cycles;
+    memcpy(&pc, p, sizeof(pc));
+    memcpy(&cycles, p + sizeof(pc), sizeof(cycles));
+    p += sizeof(pc) + sizeof(cycles);
+    tip[pc] = cycles;
+  }
+}
+
+compressed_trace_reader::compressed_trace_reader(const std::string &fname) :
+  ct(fname) {
+  ct.get_tip(tip);
+}
+
+size_t compressed_trace_reader::read(std::vector<inst_record> &chunk, size_t max) {
+  size_t n = 0;
+  while(n < max) {
+    if(pos == blk.size()) {
+      if(next_block == ct.num_blocks()) {
+	break;
+      }
+      blk.clear();
+      ct.decode_block(next_block++, blk);
+      pos = 0;
+    }
+    size_t c = std::min(max - n, blk.size() - pos);
+    chunk.insert(chunk.end(), blk.begin() + pos, blk.begin() + pos + c);
+    pos += c;
+    n += c;
+  }
+  return n;
+}
+
+parallel_trace_reader::parallel_trace_reader(const std::string &fname, size_t threads) :
+  ct(fname), slots(2*threads) {
+  ct.get_tip(tip);
+  for(size_t i = 0; i < threads; i++) {
+    workers.emplace_back(&parallel_trace_reader::worker, this);
+  }
+}
+
+parallel_trace_reader::~parallel_trace_reader() {
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    done = true;
+  }
+  cv.notify_all();
+  for(std::thread &t : workers) {
+    t.join();
+  }
+}
+
+void parallel_trace_reader::worker() {
+  const size_t nb = ct.num_blocks(), ns = slots.size();
+  std::unique_lock<std::mutex> lk(mtx);
+  while(true) {
+    /* block b reuses the slot of block b-ns, wait until that one is consumed */
+    cv.wait(lk, [&]() {
+      return done or (next_decode == nb) or (next_decode < (next_consume + ns));
+    });
+    if(done or (next_decode == nb)) {
+      return;
+    }
+    size_t b = next_decode++;
+    slot &s = slots[b % ns];
+    lk.unlock();
+    s.recs.clear();
+    ct.decode_block(b, s.recs);
+    lk.lock();
+    s.ready = true;
+    cv.notify_all();
+  }
+}
+
+size_t parallel_trace_reader::read(std::vector<inst_record> &chunk, size_t max) {
+  const size_t nb = ct.num_blocks(), ns = slots.size();
+  size_t n = 0;
+  while((n < max) and (next_consume < nb)) {
+    slot &s = slots[next_consume % ns];
+    if(pos == 0) {
+      std::unique_lock<std::mutex> lk(mtx);
+      cv.wait(lk, [&]() { return s.ready; });
+    }
+    size_t c = std::min(max - n, s.recs.size() - pos);
+    chunk.insert(chunk.end(), s.recs.begin() + pos, s.recs.begin() + pos + c);
+    pos += c;
+    n += c;
+    if(pos == s.recs.size()) {
+      std::lock_guard<std::mutex> lk(mtx);
+      s.ready = false;
+      next_consume++;
+      pos = 0;
+      cv.notify_all();
+    }
+  }
+  return n;
+}
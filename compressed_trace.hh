@@ -0,0 +1,130 @@
+#ifndef __compressed_trace_hh__
+#define __compressed_trace_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "inst_record.hh"
+#include "trace_reader.hh"
+
+/* delta/varint compressed retire trace:
+ *   header | block 0 | ... | block n-1 | index[n+1] | insts | tip
+ * each block holds block_size records and decodes on its own;
+ * per record the pc is a zigzag varint delta from pc+4 with the
+ * low bits flagging a change in the vpc-pc offset or an inst word
+ * that differs from the one recorded for that pc in the insts table */
+struct compressed_trace_header {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t n_records;
+  uint64_t block_size;
+  uint64_t n_blocks;
+  uint64_t n_insts;
+  uint64_t n_tip;
+  uint64_t index_offs;
+  uint64_t insts_offs;
+  uint64_t tip_offs;
+};
+
+struct compressed_inst_entry {
+  uint64_t pc;
+  uint64_t inst;
+};
+
+class compressed_trace {
+public:
+  static const uint64_t magic = 0x746d636334367672UL;
+  static const uint64_t version = 1;
+  /* flag bits below the pc delta */
+  static const uint64_t vpc_flag = 1;
+  static const uint64_t inst_flag = 2;
+  static const uint64_t abs_pc_flag = 4;
+  static const uint64_t flag_bits = 3;
+private:
+  int fd = -1;
+  uint8_t *buf = nullptr;
+  size_t len = 0;
+  const compressed_trace_header *hdr = nullptr;
+  const uint64_t *index = nullptr;
+  std::unordered_map<uint64_t, uint32_t> insts;
+public:
+  compressed_trace(const std::string &fname);
+  ~compressed_trace();
+  compressed_trace(const compressed_trace &) = delete;
+  compressed_trace &operator=(const compressed_trace &) = delete;
+
+  static bool is_compressed(const std::string &fname);
+  static bool write(const std::string &fname, trace_reader &tr, uint64_t block_size);
+
+  size_t size() const {
+    return hdr->n_records;
+  }
+  size_t num_blocks() const {
+    return hdr->n_blocks;
+  }
+  size_t block_size() const {
+    return hdr->block_size;
+  }
+  /* safe to call concurrently */
+  void decode_block(size_t b, std::vector<inst_record> &out) const;
+  /* pc of the first record of block b, without decoding the rest */
+  uint64_t block_pc(size_t b) const;
+  void get_tip(std::map<int64_t, double> &tip) const;
+};
+
+class compressed_trace_reader : public trace_reader {
+private:
+  compressed_trace ct;
+  std::vector<inst_record> blk;
+  size_t next_block = 0, pos = 0;
+  std::map<int64_t, double> tip;
+public:
+  compressed_trace_reader(const std::string &fname);
+  size_t read(std::vector<inst_record> &chunk, size_t max) override;
+  const std::map<int64_t, double> &get_tip() const override {
+    return tip;
+  }
+  bool size(uint64_t &n) const override {
+    n = ct.size();
+    return true;
+  }
+};
+
+/* decodes blocks on worker threads into a ring of per-block
+ * buffers and hands them to the caller in trace order */
+class parallel_trace_reader : public trace_reader {
+private:
+  struct slot {
+    std::vector<inst_record> recs;
+    bool ready = false;
+  };
+  compressed_trace ct;
+  std::vector<slot> slots;
+  std::vector<std::thread> workers;
+  std::mutex mtx;
+  std::condition_variable cv;
+  size_t next_decode = 0, next_consume = 0, pos = 0;
+  bool done = false;
+  std::map<int64_t, double> tip;
+  void worker();
+public:
+  parallel_trace_reader(const std::string &fname, size_t threads);
+  ~parallel_trace_reader();
+  size_t read(std::vector<inst_record> &chunk, size_t max) override;
+  const std::map<int64_t, double> &get_tip() const override {
+    return tip;
+  }
+  bool size(uint64_t &n) const override {
+    n = ct.size();
+    return true;
+  }
+};
+
+#endif
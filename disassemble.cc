@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <array>
 #include <map>
+#include <mutex>
 #include <string>
 #include <capstone/capstone.h>
 
@@ -53,6 +54,9 @@ static const std::map<cs_err, std::string> cs_error_map =
   };
 
 static csh handle;
+/* regions are analyzed on several threads, a handle is not to be
+ * shared between concurrent cs_disasm calls */
+static std::mutex handle_lock;
 
 void initCapstone() {
   cs_err C = cs_open(CS_ARCH_RISCV, CS_MODE_RISCV64, &handle);
@@ -70,6 +74,7 @@ void stopCapstone() {
 std::string getAsmString(uint32_t inst, uint64_t addr) {
   std::stringstream ss;
   cs_insn *insn = nullptr;
+  std::lock_guard<std::mutex> lk(handle_lock);
   size_t count = cs_disasm(handle,reinterpret_cast<const uint8_t *>(&inst),
 			   sizeof(inst), addr, 0, &insn);
   if(count != 1) {
@@ -0,0 +1,345 @@
+#include <iostream>
+#include <random>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+#include <boost/dynamic_bitset.hpp>
+
+#include "dominators.hh"
+#include "helper.hh"
+
+/* dfs pre-order from root : order[i] is the id numbered i, num[v] the
+ * number of id v (none when unreached) and parent[i] the number of
+ * the tree parent of number i */
+static void preorder(const cfg_graph &g, uint32_t root,
+		     std::vector<uint32_t> &order,
+		     std::vector<uint32_t> &num,
+		     std::vector<uint32_t> &parent) {
+  const uint32_t none = dominators::none;
+  std::vector<std::pair<uint32_t, const uint32_t*>> stack;
+  num.assign(g.size(), none);
+  order.clear();
+  parent.clear();
+  num[root] = 0;
+  order.push_back(root);
+  parent.push_back(none);
+  stack.emplace_back(root, g.succs(root).begin());
+  while(not(stack.empty())) {
+    uint32_t v = stack.back().first;
+    if(stack.back().second == g.succs(v).end()) {
+      stack.pop_back();
+      continue;
+    }
+    uint32_t w = *(stack.back().second++);
+    if(num[w] == none) {
+      num[w] = order.size();
+      order.push_back(w);
+      parent.push_back(num[v]);
+      stack.emplace_back(w, g.succs(w).begin());
+    }
+  }
+}
+
+/* path compression over dfs numbers : afterwards ancestor[v] is the
+ * root of v's tree in the forest and label[v] the number on the old
+ * path with the least semidominator */
+static void compress(uint32_t v, std::vector<uint32_t> &ancestor,
+		     std::vector<uint32_t> &label,
+		     const std::vector<uint32_t> &semi,
+		     std::vector<uint32_t> &path) {
+  const uint32_t none = dominators::none;
+  path.clear();
+  while(ancestor[ancestor[v]] != none) {
+    path.push_back(v);
+    v = ancestor[v];
+  }
+  while(not(path.empty())) {
+    uint32_t x = path.back(), a = ancestor[x];
+    path.pop_back();
+    if(semi[label[a]] < semi[label[x]]) {
+      label[x] = label[a];
+    }
+    ancestor[x] = ancestor[a];
+  }
+}
+
+static void toIds(const std::vector<uint32_t> &order,
+		  const std::vector<uint32_t> &dom,
+		  size_t n, std::vector<uint32_t> &idom) {
+  idom.assign(n, dominators::none);
+  for(size_t i = 1, nv = order.size(); i < nv; i++) {
+    idom[order[i]] = order[dom[i]];
+  }
+}
+
+bool dominators::parse(const std::string &s, engine &e) {
+  for(engine c : {engine::iterative, engine::lengauer_tarjan, engine::semi_nca}) {
+    if(s == name(c)) {
+      e = c;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *dominators::name(engine e) {
+  switch(e)
+    {
+    case engine::iterative:
+      return "iterative";
+    case engine::lengauer_tarjan:
+      return "lengauer-tarjan";
+    default:
+      break;
+    }
+  return "semi-nca";
+}
+
+void dominators::compute(engine e, const cfg_graph &g, uint32_t root,
+			 std::vector<uint32_t> &idom) {
+  switch(e)
+    {
+    case engine::iterative:
+      iterative(g, root, idom);
+      break;
+    case engine::lengauer_tarjan:
+      lengauerTarjan(g, root, idom);
+      break;
+    default:
+      semiNCA(g, root, idom);
+      break;
+    }
+}
+
+void dominators::iterative(const cfg_graph &g, uint32_t root,
+			   std::vector<uint32_t> &idom) {
+  using boost::dynamic_bitset;
+  std::vector<uint32_t> order, num, parent;
+  preorder(g, root, order, num, parent);
+  size_t n = order.size();
+  bool changed = true;
+
+  /* indexed by dfs number */
+  std::vector<dynamic_bitset<>> domMap(n, dynamic_bitset<>(n));
+  for(auto &d : domMap) {
+    d.set();
+  }
+  domMap[0].reset();
+  domMap[0][0] = true;
+
+  /* compute dominators */
+  do {
+    changed = false;
+    for(size_t bId = 1; bId < n; bId++) {
+      dynamic_bitset<> tdd = domMap[bId];
+      for(uint32_t p : g.preds(order[bId])) {
+	if(num[p] != none) {
+	  tdd &= domMap[num[p]];
+	}
+      }
+      tdd[bId] = true;
+      //check if changed
+      if(tdd != domMap[bId]) {
+	changed = true;
+	domMap[bId] = tdd;
+      }
+    }
+  }
+  while(changed);
+
+  std::vector<uint32_t> dom(n, 0);
+  for(size_t i = 1; i < n; i++) {
+    dynamic_bitset<> &d = domMap[i];
+    d[i] = false;
+    /* iterate over blocks that dominate current block */
+    for(size_t j = d.find_first(); j != dynamic_bitset<>::npos; j = d.find_next(j)) {
+      const dynamic_bitset<> &dd = domMap[j];
+      for(size_t k = dd.find_first(); k != dynamic_bitset<>::npos; k = dd.find_next(k)) {
+	/* if j dominates k, k can not be the immediate dominator */
+	if(k != j) {
+	  d[k] = false;
+	}
+      }
+    }
+    dom[i] = d.find_first();
+  }
+  toIds(order, dom, g.size(), idom);
+}
+
+/* Implementation from Muchnick and Lengauer-Tarjan TOPLAS
+ * paper. Vague understanding from Appel. */
+class LengauerTarjanDominators {
+private:
+  static constexpr uint32_t none = dominators::none;
+  /* all indexed by dfs number, the root is 0 */
+  /* Parent in the DFS tree */
+  std::vector<uint32_t> Parent;
+  /* Ancestor chain in DFS tree */
+  std::vector<uint32_t> Ancestor;
+  std::vector<uint32_t> Label;
+  std::vector<uint32_t> Semi;
+  std::vector<uint32_t> Idom;
+  std::vector<std::vector<uint32_t>> Buckets;
+  std::vector<uint32_t> path;
+
+  /* these methods are from Lengauer-Tarjan paper
+   * and implement O(n*lg(n)) scheme */
+  void Link(uint32_t v, uint32_t w) {
+    Ancestor[w] = v;
+  }
+  uint32_t Eval(uint32_t v) {
+    if(Ancestor[v] == none) {
+      return v;
+    }
+    else {
+      compress(v, Ancestor, Label, Semi, path);
+      return Label[v];
+    }
+  }
+
+public:
+  void operator()(const cfg_graph &g, uint32_t root, std::vector<uint32_t> &idom) {
+    std::vector<uint32_t> order, num;
+    preorder(g, root, order, num, Parent);
+    size_t n = order.size();
+    Ancestor.assign(n, none);
+    Label.resize(n);
+    std::iota(Label.begin(), Label.end(), 0);
+    Semi = Label;
+    Idom.assign(n, 0);
+    Buckets.assign(n, std::vector<uint32_t>());
+
+    for(size_t w = n - 1; w > 0; w--) {
+      for(uint32_t p : g.preds(order[w])) {
+	if(num[p] == none) {
+	  continue;
+	}
+	uint32_t u = Eval(num[p]);
+	Semi[w] = std::min(Semi[w], Semi[u]);
+      }
+      Buckets[Semi[w]].push_back(w);
+      Link(Parent[w], w);
+      /* need to understand - why parent bucket? */
+      std::vector<uint32_t> &pBucket = Buckets[Parent[w]];
+      for(uint32_t v : pBucket) {
+	/* find ancestor with lowest semidominator */
+	uint32_t u = Eval(v);
+	if(Semi[u] < Semi[v]) {
+	  /* idom is the semidominator */
+	  Idom[v] = u;
+	}
+	else {
+	  /* must defer */
+	  Idom[v] = Parent[w];
+	}
+      }
+      pBucket.clear();
+    }
+    for(size_t w = 1; w < n; w++) {
+      if(Idom[w] != Semi[w]) {
+	Idom[w] = Idom[Idom[w]];
+      }
+    }
+    toIds(order, Idom, g.size(), idom);
+  }
+};
+
+void dominators::lengauerTarjan(const cfg_graph &g, uint32_t root,
+				std::vector<uint32_t> &idom) {
+  LengauerTarjanDominators LTD;
+  LTD(g, root, idom);
+}
+
+void dominators::semiNCA(const cfg_graph &g, uint32_t root,
+			 std::vector<uint32_t> &idom) {
+  std::vector<uint32_t> order, num, parent, path;
+  preorder(g, root, order, num, parent);
+  size_t n = order.size();
+  std::vector<uint32_t> semi(n), label(n), ancestor(n, none), dom(n, 0);
+  std::iota(semi.begin(), semi.end(), 0);
+  std::iota(label.begin(), label.end(), 0);
+  /* semidominators as in Lengauer-Tarjan, each number linked to its
+   * parent as soon as it is done */
+  for(size_t w = n - 1; w > 0; w--) {
+    for(uint32_t p : g.preds(order[w])) {
+      uint32_t v = num[p];
+      if(v == none) {
+	continue;
+      }
+      if(ancestor[v] != none) {
+	compress(v, ancestor, label, semi, path);
+	v = label[v];
+      }
+      semi[w] = std::min(semi[w], semi[v]);
+    }
+    ancestor[w] = parent[w];
+  }
+  /* the idom of w is the nearest common ancestor of its parent and
+   * its semidominator in the dominator tree built so far */
+  for(size_t w = 1; w < n; w++) {
+    uint32_t d = parent[w];
+    while(d > semi[w]) {
+      d = dom[d];
+    }
+    dom[w] = d;
+  }
+  toIds(order, dom, g.size(), idom);
+}
+
+/* a chain with short forward branches, loop back edges and the odd
+ * jump anywhere (irreducible loops included), entered at 0 */
+static void randomCFG(size_t n, std::mt19937_64 &rng, cfg_graph &g) {
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  for(uint32_t v = 0; v + 1 < n; v++) {
+    edges.emplace_back(v, v + 1);
+    switch(rng() % 8)
+      {
+      case 0:
+      case 1:
+      case 2:
+	edges.emplace_back(v, std::min<uint64_t>(n - 1, v + 2 + rng() % 64));
+	break;
+      case 3:
+	edges.emplace_back(v, v - rng() % std::min<uint64_t>(v + 1, 64));
+	break;
+      case 4:
+	edges.emplace_back(v, 1 + rng() % (n - 1));
+	break;
+      default:
+	break;
+      }
+  }
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  g.build(n, edges);
+}
+
+void dominators::bench(size_t runs) {
+  static const size_t max_iterative = 1UL<<14;
+  std::mt19937_64 rng(1);
+  for(size_t n = 100; n <= 1000000; n *= 10) {
+    cfg_graph g;
+    randomCFG(n, rng, g);
+    std::vector<uint32_t> ref;
+    semiNCA(g, 0, ref);
+    std::cout << n << " blocks, " << g.numEdges() << " edges :";
+    for(engine e : {engine::iterative, engine::lengauer_tarjan, engine::semi_nca}) {
+      if((e == engine::iterative) and (n > max_iterative)) {
+	std::cout << " " << name(e) << " skipped";
+	continue;
+      }
+      double best = std::numeric_limits<double>::max();
+      std::vector<uint32_t> idom;
+      for(size_t r = 0; r < runs; r++) {
+	double t = timestamp();
+	compute(e, g, 0, idom);
+	best = std::min(best, timestamp() - t);
+      }
+      std::cout << " " << name(e) << " " << (best * 1e3) << " ms";
+      if(idom != ref) {
+	std::cout << " (disagrees with " << name(engine::semi_nca) << ")";
+      }
+    }
+    std::cout << "\n";
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef __dominators_hh__
+#define __dominators_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "cfg_graph.hh"
+
+/* immediate dominators over the dense ids of a cfg_graph. idom[v] is
+ * the id of v's immediate dominator, none for the root and for the
+ * blocks the root doesn't reach. three engines :
+ *   iterative       : dominator sets as bitsets, iterated to a fixed
+ *                     point, O(n^2) space
+ *   lengauer_tarjan : semidominators, buckets and path compression
+ *   semi_nca        : semidominators, then each idom is the nearest
+ *                     common ancestor of the parent and the semidominator
+ *                     (Georgiadis), no buckets and a single extra pass
+ * all walk the graph with an explicit stack, a million block chain
+ * doesn't overflow the call stack */
+class dominators {
+public:
+  static constexpr uint32_t none = ~0U;
+  enum class engine {iterative, lengauer_tarjan, semi_nca};
+  static bool parse(const std::string &s, engine &e);
+  static const char *name(engine e);
+  static void compute(engine e, const cfg_graph &g, uint32_t root,
+		      std::vector<uint32_t> &idom);
+  static void iterative(const cfg_graph &g, uint32_t root,
+			std::vector<uint32_t> &idom);
+  static void lengauerTarjan(const cfg_graph &g, uint32_t root,
+			     std::vector<uint32_t> &idom);
+  static void semiNCA(const cfg_graph &g, uint32_t root,
+		      std::vector<uint32_t> &idom);
+  /* times the engines (best of runs) on random CFGs of 100 to 1M
+   * blocks and checks they agree. iterative stops at 16K blocks */
+  static void bench(size_t runs);
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "framed_trace.hh"
+
+static void write_frame_header(std::ofstream &out, uint32_t kind, uint32_t n) {
+  frame_header fh = {kind, n};
+  out.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
+}
+
+bool framed_trace::write(const std::string &fname, trace_reader &tr, size_t frame_size) {
+  std::ofstream out(fname, std::ios::binary);
+  if(not(out.good()) or (frame_size == 0) or (frame_size > UINT32_MAX)) {
+    return false;
+  }
+  framed_trace_header h = {magic, version};
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+  std::vector<inst_record> chunk;
+  std::vector<framed_inst_entry> entries;
+  while(size_t n = tr.read(chunk, frame_size)) {
+    entries.clear();
+    for(const inst_record &r : chunk) {
+      entries.push_back(framed_inst_entry{r.pc, r.vpc, r.inst, 0});
+    }
+    write_frame_header(out, records_frame, n);
+    out.write(reinterpret_cast<const char*>(entries.data()), n*sizeof(framed_inst_entry));
+    chunk.clear();
+  }
+  write_frame_header(out, tip_frame, tr.get_tip().size());
+  for(const auto &p : tr.get_tip()) {
+    framed_tip_entry e = {p.first, p.second};
+    out.write(reinterpret_cast<const char*>(&e), sizeof(e));
+  }
+  write_frame_header(out, end_frame, 0);
+  return out.good();
+}
+
+framed_trace_reader::framed_trace_reader(const std::string &fname, unsigned idle_secs,
+					 unsigned poll_ms) :
+  fname(fname), poll_ms(poll_ms), idle_secs(idle_secs) {
+  struct stat s;
+  /* blocks until a writer opens a fifo */
+  fd = open(fname.c_str(), O_RDONLY);
+  if(fd == -1 or fstat(fd, &s) != 0) {
+    std::cerr << "unable to open framed trace " << fname << "\n";
+    exit(-1);
+  }
+  fifo = S_ISFIFO(s.st_mode);
+  framed_trace_header h;
+  if(not(fill(sizeof(h), true))) {
+    std::cerr << fname << " ended before its header\n";
+    exit(-1);
+  }
+  memcpy(&h, buf.data() + pos, sizeof(h));
+  pos += sizeof(h);
+  if(h.magic != framed_trace::magic or h.version != framed_trace::version) {
+    std::cerr << fname << " has bad framed trace header\n";
+    exit(-1);
+  }
+}
+
+framed_trace_reader::~framed_trace_reader() {
+  if(fd != -1) {
+    close(fd);
+  }
+}
+
+/* make need bytes available at pos, returns false at the end of the
+ * trace or, when not waiting, if they haven't been written yet */
+bool framed_trace_reader::fill(size_t need, bool wait) {
+  static const size_t read_size = 1UL<<20;
+  /* polls of a regular file that hasn't grown */
+  uint64_t idle_polls = 0;
+  while((buf.size() - pos) < need) {
+    if(ended) {
+      return false;
+    }
+    if(not(wait)) {
+      pollfd p = {fd, POLLIN, 0};
+      if(poll(&p, 1, 0) == 0) {
+	return false;
+      }
+    }
+    buf.erase(buf.begin(), buf.begin() + pos);
+    pos = 0;
+    size_t old = buf.size();
+    buf.resize(old + read_size);
+    ssize_t r = ::read(fd, buf.data() + old, read_size);
+    buf.resize(old + std::max(r, static_cast<ssize_t>(0)));
+    if(r < 0) {
+      if(errno == EINTR) {
+	continue;
+      }
+      std::cerr << "read of framed trace failed : " << strerror(errno) << "\n";
+      exit(-1);
+    }
+    if(r > 0) {
+      idle_polls = 0;
+    }
+    else if(fifo) {
+      /* writer went away */
+      ended = true;
+    }
+    else if(not(wait)) {
+      return false;
+    }
+    else if(idle_secs and ((++idle_polls * poll_ms) >= (idle_secs * 1000UL))) {
+      std::cerr << fname << " stopped growing for " << idle_secs
+		<< " seconds without an end frame, it is truncated\n";
+      ended = true;
+    }
+    else {
+      usleep(poll_ms * 1000);
+    }
+  }
+  return true;
+}
+
+size_t framed_trace_reader::read(std::vector<inst_record> &chunk, size_t max) {
+  size_t n = 0;
+  while(n < max) {
+    if(left == 0) {
+      frame_header fh;
+      if(not(fill(sizeof(fh), n == 0))) {
+	break;
+      }
+      memcpy(&fh, buf.data() + pos, sizeof(fh));
+      pos += sizeof(fh);
+      if(fh.kind == framed_trace::records_frame) {
+	left = fh.n;
+      }
+      else if(fh.kind == framed_trace::tip_frame) {
+	if(not(fill(fh.n * sizeof(framed_tip_entry), true))) {
+	  std::cerr << "framed trace ended inside a tip frame\n";
+	  exit(-1);
+	}
+	tip.clear();
+	for(uint32_t i = 0; i < fh.n; i++) {
+	  framed_tip_entry e;
+	  memcpy(&e, buf.data() + pos, sizeof(e));
+	  pos += sizeof(e);
+	  tip[e.pc] = e.cycles;
+	}
+      }
+      else if(fh.kind == framed_trace::end_frame) {
+	ended = true;
+	break;
+      }
+      else {
+	std::cerr << "framed trace has bad frame kind " << fh.kind << "\n";
+	exit(-1);
+      }
+      continue;
+    }
+    if(not(fill(sizeof(framed_inst_entry), n == 0))) {
+      break;
+    }
+    size_t c = std::min({static_cast<size_t>(left), max - n,
+	  (buf.size() - pos) / sizeof(framed_inst_entry)});
+    for(size_t i = 0; i < c; i++) {
+      framed_inst_entry e;
+      memcpy(&e, buf.data() + pos, sizeof(e));
+      pos += sizeof(e);
+      chunk.emplace_back(e.pc, e.vpc, e.inst);
+    }
+    left -= c;
+    n += c;
+  }
+  return n;
+}
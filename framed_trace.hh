@@ -0,0 +1,80 @@
+#ifndef __framed_trace_hh__
+#define __framed_trace_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "inst_record.hh"
+#include "trace_reader.hh"
+
+/* append-only retire trace a simulator can write while it runs:
+ *   header | frame | frame | ...
+ * each frame is a frame_header followed by n entries; records
+ * frames carry framed_inst_entry, tip frames carry the cumulative
+ * (pc, cycles) totals so far and replace any earlier tip frame,
+ * an end frame closes the trace */
+struct framed_trace_header {
+  uint64_t magic;
+  uint64_t version;
+};
+
+struct frame_header {
+  uint32_t kind;
+  uint32_t n;
+};
+
+struct framed_inst_entry {
+  uint64_t pc;
+  uint64_t vpc;
+  uint32_t inst;
+  uint32_t pad;
+};
+
+struct framed_tip_entry {
+  int64_t pc;
+  double cycles;
+};
+
+class framed_trace {
+public:
+  static const uint64_t magic = 0x6d72666334367672UL;
+  static const uint64_t version = 1;
+  enum frame_kind {records_frame = 1, tip_frame = 2, end_frame = 3};
+  static bool write(const std::string &fname, trace_reader &tr, size_t frame_size);
+};
+
+/* follows a framed trace that is still being written : waits at
+ * the end of a regular file for more data, a fifo ends when the
+ * writer closes it; read() returns whatever has arrived rather
+ * than waiting for max records. a regular file that doesn't grow
+ * for idle_secs (0 waits forever) without an end frame is taken
+ * to be truncated and ends there */
+class framed_trace_reader : public trace_reader {
+private:
+  std::string fname;
+  int fd = -1;
+  bool fifo = false, ended = false;
+  unsigned poll_ms, idle_secs;
+  std::vector<uint8_t> buf;
+  size_t pos = 0;
+  /* records still to come in the current frame */
+  uint32_t left = 0;
+  std::map<int64_t, double> tip;
+  bool fill(size_t need, bool wait);
+public:
+  framed_trace_reader(const std::string &fname, unsigned idle_secs = 0,
+		      unsigned poll_ms = 100);
+  ~framed_trace_reader();
+  framed_trace_reader(const framed_trace_reader &) = delete;
+  framed_trace_reader &operator=(const framed_trace_reader &) = delete;
+  size_t read(std::vector<inst_record> &chunk, size_t max) override;
+  /* latest tip frame seen so far */
+  const std::map<int64_t, double> &get_tip() const override {
+    return tip;
+  }
+};
+
+#endif
@@ -148,6 +148,41 @@ bool isPow2(T x) {
   return (((x-1)&x) == 0);
 }
 
+/* LEB128-style variable length integers */
+template <typename C>
+void put_varint(C &out, uint64_t x) {
+  while(x >= 0x80) {
+    out.push_back(static_cast<uint8_t>(x | 0x80));
+    x >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(x));
+}
+
+/* false, with p somewhere before e, if the integer runs into e or
+ * past 64 bits */
+inline bool get_varint(const uint8_t *&p, const uint8_t *e, uint64_t &x) {
+  x = 0;
+  for(uint32_t s = 0; s <= 63; s += 7) {
+    if(p == e) {
+      return false;
+    }
+    uint8_t b = *p++;
+    x |= static_cast<uint64_t>(b & 0x7f) << s;
+    if((b & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline uint64_t zigzag(int64_t x) {
+  return (static_cast<uint64_t>(x) << 1) ^ static_cast<uint64_t>(x >> 63);
+}
+
+inline int64_t unzigzag(uint64_t x) {
+  return static_cast<int64_t>((x >> 1) ^ (~(x & 1) + 1));
+}
+
 std::string gethostname();
 std::string strip_path(const char* str);
 
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <set>
+
+#include "hot_regions.hh"
+#include "basicBlock.hh"
+#include "regionCFG.hh"
+#include "riscv.hh"
+
+/* retired instructions stand in for cycles in a trace without TIP */
+static double blockCycles(const basicBlock *bb, const pc_profile &prof, bool tip) {
+  double c = 0.0;
+  for(const auto &ins : bb->getVecIns()) {
+    c += tip ? prof.cycles_at(ins.prof) : prof.count_at(ins.prof);
+  }
+  return c;
+}
+
+static uint64_t entryCount(const basicBlock *bb, const pc_profile &prof) {
+  return bb->empty() ? 0 : prof.count_at(bb->getVecIns().front().prof);
+}
+
+static bool endsInCall(const basicBlock *bb) {
+  if(bb->empty()) {
+    return false;
+  }
+  uint32_t inst = bb->getVecIns().back().inst;
+  return is_jal(inst) or is_jalr(inst);
+}
+
+static bool endsInRet(const basicBlock *bb) {
+  return not(bb->empty()) and is_ret(bb->getVecIns().back().inst);
+}
+
+std::vector<hot_region> formHotRegions(const std::vector<basicBlock*> &blocks,
+				       const pc_profile &prof, uint64_t start_pc,
+				       double coverage, double &total) {
+  std::vector<basicBlock*> entries;
+  std::set<basicBlock*> is_entry;
+  auto addEntry = [&entries, &is_entry](basicBlock *bb) {
+    if(bb and is_entry.insert(bb).second) {
+      entries.push_back(bb);
+    }
+  };
+  total = 0.0;
+  for(basicBlock *bb : blocks) {
+    total += blockCycles(bb, prof, true);
+  }
+  const bool tip = (total != 0.0);
+  total = 0.0;
+  /* merging may have folded the first block into another */
+  addEntry(basicBlock::bbInBlock(start_pc));
+  for(basicBlock *bb : blocks) {
+    total += blockCycles(bb, prof, tip);
+    if(bb->getPreds().empty()) {
+      addEntry(bb);
+    }
+    if(endsInCall(bb)) {
+      for(basicBlock *nbb : bb->getSuccs()) {
+	addEntry(nbb);
+      }
+    }
+  }
+  /* hotter functions claim shared code first */
+  std::sort(entries.begin(), entries.end(),
+	    [&prof](const basicBlock *a, const basicBlock *b) {
+	      uint64_t ca = entryCount(a, prof), cb = entryCount(b, prof);
+	      if(ca != cb) {
+		return ca > cb;
+	      }
+	      return a->getEntryAddr() < b->getEntryAddr();
+	    });
+
+  std::vector<hot_region> regions;
+  std::set<basicBlock*> claimed;
+  std::vector<basicBlock*> stack;
+  for(basicBlock *e : entries) {
+    hot_region r;
+    r.entry = e;
+    auto visit = [&](basicBlock *bb) {
+      if(is_entry.count(bb) or not(claimed.insert(bb).second)) {
+	return;
+      }
+      stack.push_back(bb);
+    };
+    stack.push_back(e);
+    while(not(stack.empty())) {
+      basicBlock *bb = stack.back();
+      stack.pop_back();
+      r.blocks.push_back(bb);
+      r.cycles += blockCycles(bb, prof, tip);
+      if(endsInCall(bb)) {
+	basicBlock *rbb = basicBlock::globalFindBlock(bb->getVecIns().back().pc + 4);
+	if(rbb) {
+	  r.calls.emplace_back(bb, rbb);
+	  visit(rbb);
+	}
+      }
+      else if(not(endsInRet(bb))) {
+	for(basicBlock *nbb : bb->getSuccs()) {
+	  visit(nbb);
+	}
+      }
+    }
+    regions.push_back(std::move(r));
+  }
+
+  std::sort(regions.begin(), regions.end(),
+	    [](const hot_region &a, const hot_region &b) {
+	      if(a.cycles != b.cycles) {
+		return a.cycles > b.cycles;
+	      }
+	      return a.entry->getEntryAddr() < b.entry->getEntryAddr();
+	    });
+  double covered = 0.0;
+  size_t n = 0;
+  while((n < regions.size()) and (covered < (coverage * total))) {
+    covered += regions[n++].cycles;
+  }
+  regions.resize(n);
+  return regions;
+}
+
+std::vector<regionCFG*> buildHotRegions(std::vector<hot_region> &regions,
+					const std::string &name,
+					const pc_profile &prof,
+					const pipeline_store &pt,
+					size_t threads) {
+  std::vector<regionCFG*> cfgs;
+  std::vector<std::stringstream> logs(regions.size());
+  for(size_t i = 0; i < regions.size(); i++) {
+    cfgs.push_back(new regionCFG(name, prof, pt));
+    cfgs.back()->setLog(logs[i]);
+  }
+  /* regions are disjoint, so no block is touched by two workers */
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for(size_t i = next++; i < regions.size(); i = next++) {
+      cfgs[i]->buildCFG(regions[i].blocks, regions[i].entry, regions[i].calls);
+    }
+  };
+  std::vector<std::thread> workers;
+  for(size_t t = 0, n = std::min(threads, regions.size()); t < n; t++) {
+    workers.emplace_back(worker);
+  }
+  for(std::thread &t : workers) {
+    t.join();
+  }
+  for(size_t i = 0; i < regions.size(); i++) {
+    std::cout << logs[i].str();
+    cfgs[i]->setLog(std::cout);
+  }
+  return cfgs;
+}
@@ -0,0 +1,45 @@
+#ifndef __hot_regions_hh__
+#define __hot_regions_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "profile.hh"
+#include "pipeline_store.hh"
+
+class basicBlock;
+class regionCFG;
+
+/* a function : the blocks reachable from its entry without entering
+ * another function, stepping over calls and stopping at returns */
+struct hot_region {
+  basicBlock *entry = nullptr;
+  std::vector<basicBlock*> blocks;
+  /* call block -> return site, standing in for the callee */
+  std::vector<std::pair<basicBlock*, basicBlock*>> calls;
+  double cycles = 0.0;
+};
+
+/* partitions the blocks into functions (entered at start_pc, a block
+ * without predecessors or the target of a linking jal/jalr). a block
+ * reachable from several entries goes to the one executed most.
+ * returns the hottest functions that together cover coverage (0 to 1)
+ * of the TIP cycles (retired instructions when there is no TIP),
+ * hottest first, and sets total to the cycles over all blocks */
+std::vector<hot_region> formHotRegions(const std::vector<basicBlock*> &blocks,
+				       const pc_profile &prof, uint64_t start_pc,
+				       double coverage, double &total);
+
+/* one regionCFG per region (dominance, SSA, loops and their dumps)
+ * built by a pool of threads. each region's log is printed once all
+ * are built, in region order */
+std::vector<regionCFG*> buildHotRegions(std::vector<hot_region> &regions,
+					const std::string &name,
+					const pc_profile &prof,
+					const pipeline_store &pt,
+					size_t threads);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef __instrecord_hh__
 #define __instrecord_hh__
 
+#include <boost/version.hpp>
 #if BOOST_VERSION >= 107400
 #include <boost/serialization/library_version_type.hpp>
 #endif
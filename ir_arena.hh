@@ -0,0 +1,72 @@
+#ifndef __ir_arena_hh__
+#define __ir_arena_hh__
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+#include "ssaInsn.hh"
+
+/* bump allocator for a region's IR (instructions, phis, the entry
+ * block's register definitions). objects are carved out of large
+ * chunks and never freed one at a time, the whole lot is destroyed
+ * (newest first) and the chunks released with the arena. SSA values
+ * are numbered per arena, so a region's names don't depend on which
+ * regions other threads built first */
+class ir_arena {
+private:
+  static constexpr size_t chunk_size = 1UL<<16;
+  static constexpr size_t align = alignof(std::max_align_t);
+  std::vector<std::unique_ptr<char[]>> chunks;
+  char *next = nullptr, *end = nullptr;
+  std::vector<std::pair<void*, void (*)(void*)>> dtors;
+  uint64_t next_uuid = 0;
+
+  void *alloc(size_t sz) {
+    sz = (sz + align - 1) & ~(align - 1);
+    if(static_cast<size_t>(end - next) < sz) {
+      size_t csz = std::max(sz, chunk_size);
+      chunks.emplace_back(new char[csz + align]);
+      char *p = chunks.back().get();
+      next = p + ((align - (reinterpret_cast<uintptr_t>(p) & (align - 1))) & (align - 1));
+      end = next + csz;
+    }
+    void *p = next;
+    next += sz;
+    return p;
+  }
+public:
+  ir_arena() = default;
+  ir_arena(const ir_arena &) = delete;
+  ir_arena &operator=(const ir_arena &) = delete;
+  ~ir_arena() {
+    clear();
+  }
+  template <typename T, typename... Args>
+  T *make(Args&&... args) {
+    T *t = new (alloc(sizeof(T))) T(std::forward<Args>(args)...);
+    if constexpr (std::is_base_of<ssaInsn, T>::value) {
+      t->uuid = next_uuid++;
+    }
+    if(not(std::is_trivially_destructible<T>::value)) {
+      dtors.emplace_back(t, [](void *p) { static_cast<T*>(p)->~T(); });
+    }
+    return t;
+  }
+  void clear() {
+    for(auto it = dtors.rbegin(); it != dtors.rend(); it++) {
+      it->second(it->first);
+    }
+    dtors.clear();
+    chunks.clear();
+    next = end = nullptr;
+    next_uuid = 0;
+  }
+};
+
+#endif
@@ -4,6 +4,13 @@
 #include <cstring>
 #include <cassert>
 #include <fstream>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <cstdio>
 #include <boost/program_options.hpp>
 
 #include <unistd.h>
@@ -15,7 +22,18 @@
 #include "regionCFG.hh"
 #include "globals.hh"
 #include "inst_record.hh"
-#include "pipeline_record.hh"
+#include "pipeline_store.hh"
+#include "columnar_trace.hh"
+#include "trace_reader.hh"
+#include "compressed_trace.hh"
+#include "framed_trace.hh"
+#include "profile.hh"
+#include "prune.hh"
+#include "simpoint.hh"
+#include "cfg_shard.hh"
+#include "cfg_cache.hh"
+#include "call_graph.hh"
+#include "hot_regions.hh"
 
 namespace globals {
   std::string templatePath;
@@ -26,12 +44,16 @@ namespace globals {
   bool dumpIR = false;
   bool dumpCFG = false;
 }
-std::map<uint64_t, std::map<uint64_t, uint64_t>> basicBlock::globalEdges;
+edge_map basicBlock::globalEdges;
 std::set<regionCFG*> regionCFG::regionCFGs;
 uint64_t regionCFG::icnt = 0;
 uint64_t regionCFG::iters = 0;
-std::map<uint64_t, basicBlock*> basicBlock::bbMap;
-std::map<uint64_t, basicBlock*> basicBlock::insMap;
+dominators::engine regionCFG::domEngine = dominators::engine::semi_nca;
+regionCFG::ssaForm regionCFG::phiPlacement = regionCFG::ssaForm::pruned;
+pc_map<basicBlock*> basicBlock::bbMap;
+pc_runs<basicBlock*> basicBlock::insMap;
+bool basicBlock::logChanges = false;
+std::vector<basicBlock::change> basicBlock::changes;
 
 static void getNextBlock(uint64_t pc) {
   basicBlock *nBB = globals::cBB->findBlock(pc);
@@ -42,82 +64,27 @@ static void getNextBlock(uint64_t pc) {
   globals::cBB = nBB;
 }
 
-static void translateRiscv(uint32_t inst, uint64_t pc, uint64_t npc, uint64_t vpc) {
-  globals::cBB->addIns(inst, pc, vpc);
-  uint32_t opcode = inst & 127;
-  switch(opcode)
-    {
-      //imm[11:0] rs1 000 rd 1100111 JALR
-    case 0x67: {
-      globals::cBB->setTermAddr(pc);      
-      getNextBlock(npc);
-      break;
-    }
-      //imm[20|10:1|11|19:12] rd 1101111 JAL
-    case 0x6f: {
-      globals::cBB->setTermAddr(pc);      
-      getNextBlock(npc);
-      break;
-    }
-    case 0x63: { /* cond branch */
-      globals::cBB->setTermAddr(pc);
-      getNextBlock(npc);
-      break;
-    }
-    case 0x73: { /* system instructions */
-      uint32_t csr_id = (inst>>20);
-      bool is_ecall = ((inst >> 7) == 0);
-      bool is_ebreak = ((inst>>7) == 0x2000);
-      bool bits19to7z = (((inst >> 7) & 8191) == 0);
-      uint64_t upper7 = (inst>>25);
-      bool is_cflow = false;
-      if(is_ecall) {
-	is_cflow = true;
-      }
-      else if(upper7 == 9 && ((inst & (16384-1)) == 0x73 )) { /* sfence */
-	is_cflow = false;
-      }
-      else if(bits19to7z and (csr_id == 0x105)) {  /* wfi */
-	is_cflow = false;
-      }
-      else if(bits19to7z and (csr_id == 0x002)) {  /* uret */
-	is_cflow = true;
-      }
-      else if(bits19to7z and (csr_id == 0x102)) {  /* sret */
-	is_cflow = true;
-      }
-      else if(bits19to7z and (csr_id == 0x202)) { /* hret */
-	is_cflow = true;
-      }
-      else if(bits19to7z and (csr_id == 0x302)) {  /* mret */
-	is_cflow = true;
-      }
-      else if(is_ebreak) {
-	is_cflow = true;
-      }
-
-      if(is_cflow) {
-	globals::cBB->setTermAddr(pc);
-	getNextBlock(npc);
-      }
-      break;
-    }
-    default:
-      break;
-    }
+static void translateRiscv(uint32_t inst, uint64_t pc, uint64_t npc, uint64_t vpc, uint32_t prof) {
+  globals::cBB->addIns(inst, pc, vpc, prof);
+  if(ends_block(inst)) {
+    globals::cBB->setTermAddr(pc);
+    getNextBlock(npc);
+  }
 }
 
 
-void buildCFG(const std::list<inst_record> &trace, std::map<uint64_t,uint64_t> &counts) {
-  auto nit = trace.begin(); nit++;
-  for(auto it = trace.begin(), E = trace.end(); nit != E; ++it) {
+template <typename It>
+void buildCFG(It B, It E, pc_profile &prof) {
+  auto nit = B; nit++;
+  for(auto it = B; nit != E; ++it) {
     uint64_t npc = ~0UL;
     const inst_record & ir = *it;
     if(nit != E) {
-      npc = nit->pc;
-      basicBlock::globalEdges[ir.pc][npc]++;
+      npc = (*nit).pc;
+      basicBlock::globalEdges(ir.pc, npc)++;
     }
-    counts[ir.pc]++;
+    uint32_t pi = prof.add(ir.pc);
+    prof.retire(pi);
 #if 0
     printf("%lx %s -> %lx (cbb %lx, term %lx, read only %d)\n",
 	   ir.pc,
@@ -135,6 +102,9 @@ void buildCFG(const std::list<inst_record> &trace, std::map<uint64_t,uint64_t> &
     
     if( not(globals::cBB->isReadOnly()) ) {
       if(basicBlock::bbInBlock(ir.pc) != nullptr) {
+	/* fell into a block that already exists, from here on it is
+	 * walked read only like any other (so its terminal moves us on
+	 * even when it is ir itself) */
 	/*std::cout << *(globals::cBB); */
 
 	auto &ic = globals::cBB->getVecIns();
@@ -153,7 +123,9 @@ void buildCFG(const std::list<inst_record> &trace, std::map<uint64_t,uint64_t> &
 #endif
 	//abort();
       }
-      translateRiscv(ir.inst, ir.pc, npc, ir.vpc);
+    }
+    if( not(globals::cBB->isReadOnly()) ) {
+      translateRiscv(ir.inst, ir.pc, npc, ir.vpc, pi);
     }
     else if(ir.pc == globals::cBB->getTermAddr()) {
       auto nbb = globals::cBB->findBlock(npc);
@@ -165,17 +137,278 @@ void buildCFG(const std::list<inst_record> &trace, std::map<uint64_t,uint64_t> &
     ++nit;
   }
 }
+/* streaming variant : memory is bounded by the chunk size
+ * plus the static blocks, not the dynamic instruction count */
+static uint64_t buildCFG(trace_reader &tr, size_t chunk_size,
+			 pc_profile &prof,
+			 uint64_t &start_pc,
+			 const std::function<void(uint64_t)> &on_chunk = nullptr) {
+  std::vector<inst_record> chunk;
+  uint64_t n = 0;
+  chunk.reserve(chunk_size + 1);
+  while(size_t c = tr.read(chunk, chunk_size)) {
+    if(n == 0) {
+      start_pc = chunk.front().pc;
+      globals::cBB = new basicBlock(start_pc);
+    }
+    n += c;
+    buildCFG(chunk.begin(), chunk.end(), prof);
+    /* last record is processed once the next pc is known */
+    chunk.erase(chunk.begin(), chunk.end() - 1);
+    if(on_chunk) {
+      on_chunk(n);
+    }
+  }
+  return n;
+}
+
+/* parallel variant over the n records from B : shards are
+ * contiguous runs of records, the last record of a shard is
+ * paired with the first of the next. false (with nothing built)
+ * when the shards can't reproduce the sequential walk */
+template <typename It>
+static bool buildShardedCFG(It B, size_t n, size_t shards, pc_profile &prof) {
+  if(n < 2) {
+    return false;
+  }
+  std::vector<It> starts;
+  It it = B;
+  size_t pos = 0;
+  for(size_t s = 0; s <= shards; s++) {
+    size_t at = ((n - 1) * s) / shards;
+    std::advance(it, at - pos);
+    pos = at;
+    starts.push_back(it);
+  }
+  std::vector<cfg_shard> sh(shards);
+  cfg_shard::fill(sh, [&starts](size_t s, cfg_shard &c) {
+      It nit = starts[s];
+      for(It it = starts[s]; it != starts[s+1]; ++it) {
+	++nit;
+	c.retire(*it, (*nit).pc);
+      }
+    });
+  return cfg_shard::build(sh, (*B).pc, prof);
+}
+
+/* same over a compressed trace, shards own whole blocks */
+static bool buildShardedCFG(const compressed_trace &zt, size_t shards, pc_profile &prof) {
+  const size_t nb = zt.num_blocks();
+  if(zt.size() < 2) {
+    return false;
+  }
+  std::vector<cfg_shard> sh(shards);
+  cfg_shard::fill(sh, [&zt, nb, shards](size_t s, cfg_shard &c) {
+      size_t b = (nb * s) / shards, e = (nb * (s + 1)) / shards;
+      std::vector<inst_record> recs;
+      for(; b < e; b++) {
+	zt.decode_block(b, recs);
+	for(size_t i = 0; (i + 1) < recs.size(); i++) {
+	  c.retire(recs[i], recs[i+1].pc);
+	}
+	recs.erase(recs.begin(), recs.end() - 1);
+      }
+      if(not(recs.empty()) and (e < nb)) {
+	c.retire(recs.front(), zt.block_pc(e));
+      }
+    });
+  return cfg_shard::build(sh, zt.block_pc(0), prof);
+}
+
+/* synthetic trace for --bench : an n instruction straight line block
+ * (closed by a jal to a jalr that jumps back into it) is run from its
+ * head, then entered at every 8th instruction in ascending order, so
+ * each late discovered target splits the biggest block there is */
+static void lateTargetTrace(size_t n, std::list<inst_record> &recs) {
+  const uint64_t base = 0x10000, disp = base + 4*n;
+  const uint32_t nop = 0x13, jal = 0x6f, jalr = 0x67;
+  for(size_t k = 0; k < n; k += 8) {
+    for(size_t i = k; i < n; i++) {
+      uint64_t pc = base + 4*i;
+      recs.emplace_back(pc, pc, (i == (n-1)) ? jal : nop);
+    }
+    recs.emplace_back(disp, disp, jalr);
+  }
+}
+
+/* start building blocks at pc without an edge from the block we
+ * were in, used when the trace jumps to the next pruned window */
+static void restartAt(uint64_t pc) {
+  if(globals::cBB == nullptr) {
+    globals::cBB = new basicBlock(pc);
+    return;
+  }
+  auto &ic = globals::cBB->getVecIns();
+  if(not(globals::cBB->isReadOnly()) and not(ic.empty())) {
+    globals::cBB->setTermAddr(ic.back().pc);
+    globals::cBB->setReadOnly();
+  }
+  basicBlock *nBB = basicBlock::globalFindBlock(pc);
+  if(nBB == nullptr) {
+    basicBlock *sBB = basicBlock::bbInBlock(pc);
+    nBB = sBB ? sBB->split(pc) : new basicBlock(pc);
+  }
+  globals::cBB = nBB;
+}
+
+/* sh, when there is one, also gets the window's records so its
+ * counts and edges can be scaled by the window's weight */
+template <typename It>
+static void buildWindow(It B, It E, trace_pruner &pruner, double scale,
+			cfg_shard *sh, pc_profile &prof) {
+  restartAt((*B).pc);
+  for(auto it = B; it != E; ++it) {
+    pruner.keep(*it, scale);
+    if(sh and (std::next(it) != E)) {
+      sh->retire(*it, (*std::next(it)).pc);
+    }
+  }
+  buildCFG(B, E, prof);
+}
 
+/* streaming variant of the above over every selected window, sh
+ * is empty or has a shard per window */
+static void buildWindows(trace_reader &tr, size_t chunk_size,
+			 const std::vector<trace_pruner::window> &windows,
+			 trace_pruner &pruner, std::vector<cfg_shard> &sh,
+			 pc_profile &prof) {
+  std::vector<inst_record> chunk, win;
+  uint64_t n = 0;
+  size_t w = 0;
+  double scale = 1.0;
+  win.reserve(chunk_size + 1);
+  auto build = [&]() {
+    if(not(sh.empty())) {
+      for(size_t i = 0; (i + 1) < win.size(); i++) {
+	sh[w].retire(win[i], win[i+1].pc);
+      }
+    }
+    buildCFG(win.begin(), win.end(), prof);
+  };
+  while(tr.read(chunk, chunk_size) and (w < windows.size())) {
+    for(const inst_record &r : chunk) {
+      if(w == windows.size()) {
+	break;
+      }
+      if(n == windows[w].start) {
+	restartAt(r.pc);
+	scale = pruner.scale(windows[w]);
+      }
+      if(n >= windows[w].start) {
+	win.push_back(r);
+	pruner.keep(r, scale);
+	if(n == (windows[w].start + windows[w].len - 1)) {
+	  build();
+	  win.clear();
+	  w++;
+	}
+	else if(win.size() > chunk_size) {
+	  build();
+	  win.erase(win.begin(), win.end() - 1);
+	}
+      }
+      n++;
+    }
+    chunk.clear();
+  }
+  /* drain so tip gets loaded */
+  while(tr.read(chunk, chunk_size)) {
+    chunk.clear();
+  }
+}
 
+/* one CFG over several traces of a binary (checkpoints, say). each
+ * trace is entered fresh like a pruned window, so the blocks are cut
+ * at every trace's leaders, and its counts, edges and tip are scaled
+ * by its weight over the lightest trace's. the traces are profiled
+ * concurrently, a thread each, and merged as shards unless one has
+ * control flow the merge can't reproduce, in which case the blocks
+ * come from a sequential walk over them all. false if they're empty */
+static bool aggregateTraces(const std::vector<std::string> &traces,
+			    const std::vector<double> &weights,
+			    size_t chunk_size, size_t threads,
+			    pc_profile &prof, std::map<int64_t, double> &tip,
+			    uint64_t &start_pc, uint64_t &trace_len) {
+  const size_t n = traces.size();
+  std::vector<double> scale(n, 1.0);
+  if(not(weights.empty())) {
+    double w_min = *std::min_element(weights.begin(), weights.end());
+    for(size_t s = 0; s < n; s++) {
+      scale[s] = weights[s] / w_min;
+    }
+  }
+  std::vector<cfg_shard> sh(n);
+  std::vector<uint64_t> firsts(n, 0), lens(n, 0);
+  std::vector<std::map<int64_t, double>> tips(n);
+  for(size_t s = 0; s < n; s++) {
+    sh[s].set_weight(scale[s]);
+  }
+  cfg_shard::fill(sh, [&](size_t s, cfg_shard &c) {
+      std::unique_ptr<trace_reader> tr(open_trace_reader(traces[s], threads));
+      std::vector<inst_record> chunk;
+      while(size_t k = tr->read(chunk, chunk_size)) {
+	if(lens[s] == 0) {
+	  firsts[s] = chunk.front().pc;
+	  c.lead(firsts[s]);
+	}
+	lens[s] += k;
+	for(size_t i = 0; (i + 1) < chunk.size(); i++) {
+	  c.retire(chunk[i], chunk[i+1].pc);
+	}
+	/* last record is retired once the next pc is known */
+	chunk.erase(chunk.begin(), chunk.end() - 1);
+      }
+      tips[s] = tr->get_tip();
+    });
 
+  trace_len = 0;
+  for(size_t s = n; s > 0; s--) {
+    if(lens[s-1]) {
+      start_pc = firsts[s-1];
+    }
+    trace_len += std::llround(lens[s-1] * scale[s-1]);
+    for(const auto &p : tips[s-1]) {
+      tip[p.first] += p.second * scale[s-1];
+    }
+  }
+  if(trace_len == 0) {
+    return false;
+  }
+  if(cfg_shard::build(sh, start_pc, prof)) {
+    return true;
+  }
+  for(const std::string &t : traces) {
+    std::unique_ptr<trace_reader> tr(open_trace_reader(t, threads));
+    std::vector<inst_record> chunk;
+    bool fresh = true;
+    while(tr->read(chunk, chunk_size)) {
+      if(fresh) {
+	restartAt(chunk.front().pc);
+	fresh = false;
+      }
+      buildCFG(chunk.begin(), chunk.end(), prof);
+      chunk.erase(chunk.begin(), chunk.end() - 1);
+    }
+  }
+  cfg_shard::reduce(sh, prof);
+  return true;
+}
 
 int main(int argc, char *argv[]) {
   namespace po = boost::program_options; 
   retire_trace rt;
   pipeline_reader pt;
-  std::string input, pipe;
-  bool prune, merge;
-  std::map<uint64_t,uint64_t> counts;
+  std::string input, pipe, dom_engine, ssa_form, convert, compress, framed;
+  std::string keep, kernel_base, slices, cache;
+  std::vector<std::string> firmware, traces;
+  std::vector<double> weights;
+  bool prune, merge, stream, follow, callgraph;
+  size_t chunk_size, block_size, threads, shards, report_secs, num_windows;
+  unsigned follow_timeout;
+  uint64_t min_window, sp_interval, sp_seed;
+  size_t sp_max_k, sp_dims, bench_iters, late_targets, region_threads, dom_bench;
+  double region_pct;
+  pc_profile prof;
 
   char *rp = realpath(argv[0], nullptr);
   globals::templatePath = std::string(dirname(rp));
@@ -186,9 +419,41 @@ int main(int argc, char *argv[]) {
     desc.add_options() 
       ("help", "Print help messages")
       ("in,i", po::value<std::string>(&input), "input dump")
+      ("traces", po::value<std::vector<std::string>>(&traces)->multitoken(), "aggregate several input dumps (checkpoints of one binary) into one CFG, in place of -i")
+      ("weights", po::value<std::vector<double>>(&weights)->multitoken(), "relative weight of each of --traces (default 1)")
       ("pipe,p", po::value<std::string>(&pipe), "pipe dump")
+      ("convert", po::value<std::string>(&convert), "write input dump as columnar trace and exit")
+      ("compress", po::value<std::string>(&compress), "write input dump as compressed trace and exit")
+      ("framed", po::value<std::string>(&framed), "write input dump as framed trace and exit")
+      ("block", po::value<size_t>(&block_size)->default_value(1UL<<16), "records per block of a compressed trace (or frame of a framed trace)")
+      ("threads", po::value<size_t>(&threads)->default_value(1), "worker threads for decoding compressed traces")
+      ("shards", po::value<size_t>(&shards)->default_value(1), "threads building the CFG from contiguous trace shards")
       ("prune", po::value<bool>(&prune)->default_value(false), "prune trace")
+      ("keep", po::value<std::string>(&keep)->default_value("user"), "address class pruning keeps (user, kernel or firmware)")
+      ("windows", po::value<size_t>(&num_windows)->default_value(1), "number of longest windows pruning keeps, 0 keeps all")
+      ("min-window", po::value<uint64_t>(&min_window)->default_value(0), "records a window needs for pruning to keep it")
+      ("simpoint", po::value<uint64_t>(&sp_interval)->default_value(0), "pick simpoints over intervals of this many records")
+      ("max-k", po::value<size_t>(&sp_max_k)->default_value(10), "most simpoint clusters")
+      ("dims", po::value<size_t>(&sp_dims)->default_value(15), "dimensions basic block vectors are projected to")
+      ("seed", po::value<uint64_t>(&sp_seed)->default_value(1), "simpoint random seed")
+      ("bench", po::value<size_t>(&bench_iters)->default_value(0), "time buildCFG over the in-memory trace this many times and exit")
+      ("late-targets", po::value<size_t>(&late_targets)->default_value(0), "--bench a synthetic trace in place of -i, an n instruction block split at every 8th instruction")
+      ("slices", po::value<std::string>(&slices), "build the CFG over the intervals of a simpoints file only")
+      ("callgraph", po::value<bool>(&callgraph)->default_value(false), "replay the trace with a shadow call stack, per function inclusive and exclusive TIP to <input>_callgraph.txt")
+      ("regions", po::value<double>(&region_pct)->default_value(0.0), "analyze the hottest functions covering this percent of TIP cycles, each as a region of its own (0 for one whole program region)")
+      ("region-threads", po::value<size_t>(&region_threads)->default_value(0), "threads analyzing --regions (0 for one per core)")
+      ("dominators", po::value<std::string>(&dom_engine)->default_value("semi-nca"), "dominator engine (semi-nca, lengauer-tarjan or iterative)")
+      ("ssa", po::value<std::string>(&ssa_form)->default_value("pruned"), "phi placement (pruned by liveness, semi-pruned or minimal)")
+      ("dom-bench", po::value<size_t>(&dom_bench)->default_value(0), "time the dominator engines (best of this many runs) on random CFGs of 100 to 1M blocks and exit")
+      ("cache", po::value<std::string>(&cache), "directory of built CFGs keyed by trace hash and options, loaded in place of a rebuild")
+      ("kernel-base", po::value<std::string>(&kernel_base)->default_value("8000000000000000"), "lowest kernel vpc (hex)")
+      ("firmware", po::value<std::vector<std::string>>(&firmware)->multitoken()->default_value(std::vector<std::string>{"200000-201000"}, "200000-201000"), "firmware vpc ranges lo-hi (hex, inclusive)")
       ("merge", po::value<bool>(&merge)->default_value(true), "merge basicblocks when legal")      
+      ("stream", po::value<bool>(&stream)->default_value(false), "decode input dump in chunks while building the CFG")
+      ("chunk", po::value<size_t>(&chunk_size)->default_value(1UL<<16), "records per chunk in streaming mode")
+      ("follow", po::value<bool>(&follow)->default_value(false), "follow a framed trace (file or fifo) while it is written")
+      ("report", po::value<size_t>(&report_secs)->default_value(10), "seconds between hot block reports in follow mode")
+      ("follow-timeout", po::value<unsigned>(&follow_timeout)->default_value(60), "seconds a followed file may stop growing before it is taken as truncated, 0 waits forever")
       ; 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -198,89 +463,410 @@ int main(int argc, char *argv[]) {
     std::cerr <<"command-line error : " << e.what() << "\n";
     return -1;
   }
-  if(input.size() == 0) {
+  if(traces.size()) {
+    if(input.size() or prune or follow or bench_iters or sp_interval or
+       slices.size() or cache.size() or late_targets or
+       convert.size() or compress.size() or framed.size()) {
+      std::cout << "--traces replaces -i and can't be used with --prune, --follow, --bench, "
+		<< "--simpoint, --slices, --cache, --late-targets or trace conversion\n";
+      return -1;
+    }
+    if(chunk_size == 0) {
+      std::cout << "--chunk must be non-zero\n";
+      return -1;
+    }
+    if(weights.size() and (weights.size() != traces.size())) {
+      std::cout << "--weights needs a weight for each of --traces\n";
+      return -1;
+    }
+    for(double w : weights) {
+      if(not(w > 0.0)) {
+	std::cout << "--weights must be positive\n";
+	return -1;
+      }
+    }
+    /* reports are named after the first trace */
+    input = traces.front() + "_agg";
+  }
+  else if(weights.size()) {
+    std::cout << "--weights needs --traces\n";
+    return -1;
+  }
+  if(not(dominators::parse(dom_engine, regionCFG::domEngine))) {
+    std::cout << "unknown dominator engine " << dom_engine << "\n";
+    return -1;
+  }
+  if(not(regionCFG::parseSSAForm(ssa_form, regionCFG::phiPlacement))) {
+    std::cout << "unknown ssa form " << ssa_form << "\n";
+    return -1;
+  }
+  if(dom_bench) {
+    dominators::bench(dom_bench);
+    if(not(regionCFG::benchIncremental(dom_bench))) {
+      std::cout << "incremental dominance disagrees with a full recompute\n";
+      return -1;
+    }
+    return 0;
+  }
+  if(input.size() == 0 and late_targets == 0) {
     std::cout << "need input dump\n";
     return -1;
   }
+  if(late_targets and ((bench_iters == 0) or (late_targets < 2))) {
+    std::cout << "--late-targets needs --bench and a block of at least 2 instructions\n";
+    return -1;
+  }
   initCapstone();
-  std::ifstream trace_ifs(input, std::ios::binary);
-  boost::archive::binary_iarchive rt_(trace_ifs);
-  rt_ >> rt;
-
-  if(prune) {
-    bool in_neg = false;
-    const std::list<inst_record> &recs = rt.get_records();
-    uint64_t best_start = 0, best_len = 0, curr_start = 0;
+
+  if(convert.size() != 0 or compress.size() != 0 or framed.size() != 0) {
+    std::unique_ptr<trace_reader> cr(open_trace_reader(input));
+    bool ok = convert.size() ? columnar_trace::write(convert, *cr) :
+      compress.size() ? compressed_trace::write(compress, *cr, block_size) :
+      framed_trace::write(framed, *cr, block_size);
+    const std::string &out = convert.size() ? convert :
+      compress.size() ? compress : framed;
+    if(not(ok)) {
+      std::cout << "unable to write " << out << "\n";
+      return -1;
+    }
+    std::cout << "wrote " << out << "\n";
+    return 0;
+  }
   
-    for(auto it = recs.begin(), E = recs.end(); it != E; ++it ) {
-      auto &r = *it;
-      bool neg_addr = (r.vpc >> 63) or ((r.vpc >= 0x200000) and (r.vpc <= 0x201000));
-      if(neg_addr) {
-	if(not(in_neg)) {
-	  uint64_t num_user = std::distance(recs.begin(), it) - curr_start;
-	  //std::cout << "num_user = " << num_user << "\n";
-	  if(num_user > best_len) {
-	    best_len = num_user;
-	    best_start = curr_start;
-	  }
-	  //std::cout << "negative address space entered at "
-	  //<< std::distance(recs.begin(), it)
-	  //<< " icnt\n";
-	}
-	in_neg = true;
-      }
-      else {
-	if(in_neg) {
-	  //std::cout << "negative address space left at "
-	  //<< std::distance(recs.begin(), it)
-	  //<< " icnt\n";
-	  curr_start = std::distance(recs.begin(), it);
-	}
-	in_neg = false;
+  std::unique_ptr<columnar_trace> ct;
+  std::unique_ptr<trace_reader> tr;
+  std::unique_ptr<compressed_trace> zt;
+  uint64_t trace_len = 0, start_pc = 0;
+  std::string cache_name;
+  uint64_t cache_key = 0;
+  bool cached = false;
+  if(cache.size()) {
+    if(follow or bench_iters or sp_interval) {
+      std::cout << "--cache can't be used with --follow, --bench or --simpoint\n";
+      return -1;
+    }
+    /* only options that change the blocks, counts or tip */
+    std::stringstream opts;
+    if(prune or slices.size()) {
+      opts << "keep " << keep << " windows " << num_windows
+	   << " min-window " << min_window << " kernel-base " << kernel_base;
+      for(const std::string &f : firmware) {
+	opts << " firmware " << f;
+      }
+      if(slices.size()) {
+	opts << " slices " << std::hex << cfg_cache::key(slices, "") << std::dec;
       }
     }
+    cache_key = cfg_cache::key(input, opts.str());
+    cache_name = cache + "/" + toStringHex(cache_key) + ".cfg";
+    cached = cfg_cache::read(cache_name, cache_key, input, prof, rt.tip, start_pc, trace_len);
+    if(cached) {
+      std::cout << "loaded CFG from " << cache_name << "\n";
+    }
+  }
+  if(cached) {
+    /* blocks, profile and tip came from the cache */
+  }
+  else if(traces.size()) {
+    /* read by aggregateTraces */
+  }
+  else if(late_targets) {
+    lateTargetTrace(late_targets, rt.get_records());
+  }
+  else if(follow) {
+    /* no probing, that would eat the head of a fifo */
+    if(prune or (chunk_size == 0)) {
+      std::cout << "--follow needs a non-zero --chunk and no --prune\n";
+      return -1;
+    }
+    tr.reset(new framed_trace_reader(input, follow_timeout));
+  }
+  else if(columnar_trace::is_columnar(input)) {
+    ct.reset(new columnar_trace(input));
+    ct->get_tip(rt.tip);
+    trace_len = ct->size();
+  }
+  else if(stream or compressed_trace::is_compressed(input)) {
+    if(chunk_size == 0) {
+      std::cout << "--chunk must be non-zero\n";
+      return -1;
+    }
+    tr.reset(open_trace_reader(input, threads));
+    /* shards decode their own blocks */
+    if((shards > 1) and compressed_trace::is_compressed(input)) {
+      zt.reset(new compressed_trace(input));
+    }
+  }
+  else {
+    std::ifstream trace_ifs(input, std::ios::binary);
+    boost::archive::binary_iarchive rt_(trace_ifs);
+    rt_ >> rt;
+    trace_len = rt.get_records().size();
+  }
+
+  if(bench_iters) {
+    if(follow) {
+      std::cout << "--bench can't be used with --follow\n";
+      return -1;
+    }
+    std::vector<inst_record> recs;
+    if(ct) {
+      recs.reserve(ct->size());
+      for(size_t i = 0, n = ct->size(); i < n; i++) {
+	recs.push_back(ct->at(i));
+      }
+    }
+    else if(tr) {
+      while(tr->read(recs, chunk_size)) {}
+    }
+    else {
+      recs.assign(rt.get_records().begin(), rt.get_records().end());
+    }
+    if(recs.size() < 2) {
+      std::cout << "--bench needs a longer trace\n";
+      return -1;
+    }
+    double best = std::numeric_limits<double>::max();
+    for(size_t i = 0; i < bench_iters; i++) {
+      basicBlock::dropAllBBs();
+      basicBlock::globalEdges.clear();
+      pc_profile bprof;
+      double t = timestamp();
+      if(not((shards > 1) and buildShardedCFG(recs.begin(), recs.size(), shards, bprof))) {
+	globals::cBB = new basicBlock(recs.front().pc);
+	buildCFG(recs.begin(), recs.end(), bprof);
+      }
+      t = timestamp() - t;
+      double ns = (t * 1e9) / recs.size();
+      best = std::min(best, ns);
+      std::cout << "buildCFG : " << ns << " ns per retired instruction, "
+		<< basicBlock::numBBs() << " blocks\n";
+    }
+    std::cout << "buildCFG best : " << best << " ns per retired instruction over "
+	      << recs.size() << " records\n";
+    return 0;
+  }
+
+  if(sp_interval and (prune or follow or slices.size())) {
+    std::cout << "--simpoint needs the whole trace, drop --prune, --follow and --slices\n";
+    return -1;
+  }
+  if((region_pct < 0.0) or (region_pct > 100.0)) {
+    std::cout << "--regions is a percent of TIP cycles, 0 to 100\n";
+    return -1;
+  }
+  if(region_threads == 0) {
+    region_threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+  if(callgraph and (prune or follow or slices.size() or traces.size())) {
+    std::cout << "--callgraph needs the whole of one trace, drop --prune, --follow, --slices and --traces\n";
+    return -1;
+  }
+  if(follow and slices.size()) {
+    std::cout << "--slices can't be used with --follow\n";
+    return -1;
+  }
 
-    //std::cout << "best_start = " << best_start << "\n";
-    // std::cout << "best_len = " << best_len << "\n";
+  if(cached) {
+    /* nothing to build */
+  }
+  else if(traces.size()) {
+    if(not(aggregateTraces(traces, weights, chunk_size, threads, prof, rt.tip,
+			   start_pc, trace_len))) {
+      std::cout << "--traces are empty\n";
+      return -1;
+    }
+    std::cout << "aggregated " << traces.size() << " traces\n";
+  }
+  else if(prune or slices.size()) {
+    trace_pruner::addr_class keep_class;
+    std::vector<std::pair<uint64_t, uint64_t>> fw_ranges;
+    if(not(trace_pruner::parse_class(keep, keep_class))) {
+      std::cout << "--keep must be user, kernel or firmware\n";
+      return -1;
+    }
+    for(const std::string &f : firmware) {
+      std::pair<uint64_t, uint64_t> r;
+      if(not(trace_pruner::parse_range(f, r))) {
+	std::cout << "bad firmware range " << f << "\n";
+	return -1;
+      }
+      fw_ranges.push_back(r);
+    }
+    trace_pruner pruner(keep_class, strtoull(kernel_base.c_str(), nullptr, 16), fw_ranges);
+    if(slices.size()) {
+      std::vector<simpoint::point> pts;
+      std::vector<trace_pruner::window> sw;
+      if(not(simpoint::read(slices, pts))) {
+	std::cout << "unable to read simpoints from " << slices << "\n";
+	return -1;
+      }
+      for(const simpoint::point &p : pts) {
+	sw.push_back(trace_pruner::window{p.start, p.len, 0, p.weight});
+      }
+      pruner.set_windows(sw);
+      keep = "simpoint";
+    }
 
-    std::list<inst_record> records;
-    size_t p = 0;
-    std::map<int64_t, uint64_t> org_icnts, new_icnts;
-    for(auto r : recs) {
-      if((p >= best_start) and (p < (best_start+best_len))) {
-	records.push_back(r);
-	new_icnts[r.pc]++;      
+    /* pass one finds the windows */
+    if(ct) {
+      for(size_t i = 0, n = ct->size(); i < n; i++) {
+	pruner.scan(ct->at(i));
       }
-      org_icnts[r.pc]++;      
-      ++p;
     }
-    /* scale tip data based on ratio of old icnt and new icnt */
-    std::map<int64_t, double> tip;
-    for(auto p : new_icnts) {
-      uint64_t nc = p.second;
-      uint64_t oc = org_icnts.at(p.first);
-      tip[p.first] = (rt.tip.at(p.first) / oc) * nc;
+    else if(tr) {
+      std::unique_ptr<trace_reader> sr(open_trace_reader(input, threads));
+      std::vector<inst_record> chunk;
+      while(sr->read(chunk, chunk_size)) {
+	for(const inst_record &r : chunk) {
+	  pruner.scan(r);
+	}
+	chunk.clear();
+      }
+    }
+    else {
+      for(const inst_record &r : rt.get_records()) {
+	pruner.scan(r);
+      }
+    }
+    std::vector<trace_pruner::window> windows = pruner.select(num_windows, min_window);
+    if(windows.empty()) {
+      std::cout << "no " << keep << " window to keep\n";
+      return -1;
+    }
+
+    /* pass two builds the CFG over them. simpoint slices stand for
+     * their clusters : each one's counts, edges and tip are scaled by
+     * its weight's share of the trace over its length */
+    std::vector<cfg_shard> wsh(slices.size() ? windows.size() : 0);
+    for(size_t i = 0; i < wsh.size(); i++) {
+      wsh[i].set_weight(pruner.scale(windows[i]));
+    }
+    if(ct) {
+      for(size_t i = 0; i < windows.size(); i++) {
+	auto B = ct->begin() + windows[i].start;
+	buildWindow(B, B + windows[i].len, pruner, pruner.scale(windows[i]),
+		    wsh.empty() ? nullptr : &wsh[i], prof);
+      }
+    }
+    else if(tr) {
+      buildWindows(*tr, chunk_size, windows, pruner, wsh, prof);
+      rt.tip = tr->get_tip();
+    }
+    else {
+      auto it = rt.get_records().begin();
+      uint64_t pos = 0;
+      for(size_t i = 0; i < windows.size(); i++) {
+	const auto &w = windows[i];
+	std::advance(it, w.start - pos);
+	auto e = std::next(it, w.len);
+	buildWindow(it, e, pruner, pruner.scale(w),
+		    wsh.empty() ? nullptr : &wsh[i], prof);
+	it = e;
+	pos = w.start + w.len;
+      }
     }
+    if(not(wsh.empty())) {
+      cfg_shard::reduce(wsh, prof);
+    }
+    std::map<int64_t, double> tip;
+    pruner.rescale(rt.tip, tip);
     rt.tip = tip;
-    //std::cout << "records.size() =  " << records.size() << "\n";
-    rt.records = records;
+    start_pc = windows.front().pc;
+    double len = 0.0;
+    for(const auto &w : windows) {
+      len += w.len * pruner.scale(w);
+    }
+    trace_len = std::llround(len);
+    std::cout << "pruned to " << windows.size() << " " << keep << " windows\n";
+  }
+  else if(tr and follow) {
+    /* hot block and loop reports over everything seen so far, written
+     * to a temp file and renamed so a reader never sees a partial
+     * report. the loops come from a region whose dominator tree is
+     * updated as the build adds blocks, splits and edges */
+    const std::string live = input + "_cfg_live.txt";
+    const std::string liveLoops = input + "_loops_live.txt";
+    regionCFG follower(input, prof, pt.get_store());
+    basicBlock::logChanges = true;
+    auto liveReport = [&]() {
+      std::set<const basicBlock*> bbs;
+      for(const auto &p : basicBlock::bbMap) {
+	if(not(p.second->empty())) {
+	  bbs.insert(p.second);
+	}
+      }
+      prof.set_tip(tr->get_tip());
+      std::string tmp = live + ".tmp";
+      writeHotBlocks(tmp, bbs, prof, false);
+      rename(tmp.c_str(), live.c_str());
+      tmp = liveLoops + ".tmp";
+      follower.writeLiveLoops(tmp);
+      rename(tmp.c_str(), liveLoops.c_str());
+    };
+    auto last = std::chrono::steady_clock::now();
+    auto report = [&](uint64_t n) {
+      follower.followChanges();
+      auto now = std::chrono::steady_clock::now();
+      if(now - last < std::chrono::seconds(report_secs)) {
+	return;
+      }
+      last = now;
+      liveReport();
+      std::cout << n << " records, " << basicBlock::numBBs() << " blocks so far\n";
+    };
+    trace_len = buildCFG(*tr, chunk_size, prof, start_pc, report);
+    basicBlock::logChanges = false;
+    follower.followChanges();
+    rt.tip = tr->get_tip();
+    liveReport();
+  }
+  else if(tr) {
+    if(zt and buildShardedCFG(*zt, shards, prof)) {
+      start_pc = zt->block_pc(0);
+      trace_len = zt->size();
+    }
+    else {
+      trace_len = buildCFG(*tr, chunk_size, prof, start_pc);
+    }
+    rt.tip = tr->get_tip();
+  }
+  else if(ct) {
+    start_pc = ct->pc(0);
+    if(not((shards > 1) and buildShardedCFG(ct->begin(), ct->size(), shards, prof))) {
+      globals::cBB = new basicBlock(start_pc);
+      buildCFG(ct->begin(), ct->end(), prof);
+    }
+  }
+  else {
+    start_pc = rt.get_records().begin()->pc;
+    if(not((shards > 1) and buildShardedCFG(rt.get_records().begin(), trace_len, shards, prof))) {
+      globals::cBB = new basicBlock(start_pc);
+      buildCFG(rt.get_records().begin(), rt.get_records().end(), prof);
+    }
+  }
+
+  if(cache.size() and not(cached)) {
+    if(cfg_cache::write(cache_name, cache_key, input, prof, rt.tip, start_pc, trace_len)) {
+      std::cout << "wrote CFG to " << cache_name << "\n";
+    }
+    else {
+      std::cout << "unable to write " << cache_name << "\n";
+    }
   }
-  std::cout << std::hex << "start pc : " << std::hex << rt.get_records().begin()->pc << std::dec << "\n";
+  
+  std::cout << std::hex << "start pc : " << std::hex << start_pc << std::dec << "\n";
   
   double tip_cycles = 0.0;
   for(auto p : rt.tip) {
     tip_cycles += p.second;
   }
 
-  std::cout << "rt.get_records().size() = " <<
-    rt.get_records().size() << "\n";
+  std::cout << "rt.get_records().size() = " << trace_len << "\n";
 
   std::cout << "tip cycles = " << tip_cycles << "\n";
 
-  globals::cBB = new basicBlock(rt.get_records().begin()->pc);
-  buildCFG(rt.get_records(), counts);
-
-  double ipc = rt.get_records().size() / tip_cycles;
+  double ipc = trace_len / tip_cycles;
   std::cout << ipc << " ipc\n";
 
   if(pipe.size() != 0) {
@@ -290,7 +876,7 @@ int main(int argc, char *argv[]) {
   std::vector<basicBlock*> r;
 
   std::list<basicBlock*> e;
-  for(auto p : basicBlock::bbMap) {
+  for(auto p : basicBlock::bbMap.sorted()) {
     basicBlock *bb = p.second;
     if(bb->empty()) {
       e.push_back(bb);
@@ -299,8 +885,7 @@ int main(int argc, char *argv[]) {
 
   for(basicBlock *ebb : e) {
     ebb->removeEmpty();    
-    auto it = basicBlock::bbMap.find(ebb->entryAddr);
-    basicBlock::bbMap.erase(it);
+    basicBlock::bbMap.erase(ebb->entryAddr);
     delete ebb;
   }
 
@@ -308,33 +893,114 @@ int main(int argc, char *argv[]) {
   
   //create region
   if(merge) {
-    bool merged = false;
-    do {
-      merged = false;
-      for(auto p : basicBlock::bbMap) {    
-	bool m = p.second->mergeWithSucc();
-	if(m) {
-	  merged = true;
-	  std::cout << "found merging candidate\n";
-	  break;
-	}
+    /* merging is confluent (a merged block takes over its successor's
+     * terminal and successors, so no other pair's legality changes),
+     * so one pass in entry order where each block absorbs its whole
+     * fall through chain reaches the same fixed point as rescanning
+     * after every merge. a block absorbed earlier in the pass is gone
+     * from bbMap by the time its entry comes up */
+    for(auto p : basicBlock::bbMap.sorted()) {
+      basicBlock **h = basicBlock::bbMap.find(p.first);
+      if(h == nullptr) {
+	continue;
+      }
+      basicBlock *bb = *h;
+      while(bb->mergeWithSucc()) {
+	std::cout << "found merging candidate\n";
       }
     }
-    while(merged);
   }
   
-  for(auto p : basicBlock::bbMap) {
+  for(auto p : basicBlock::bbMap.sorted()) {
     //if(p.second->mergableWithSucc()) {
     //std::cout << "found merging candidate\n";
     //}
     r.push_back(p.second);
   }
+
+  /* second pass over the trace, for what needs the final blocks or
+   * profile. a cached CFG leaves nothing open, so the input is read again */
+  auto replay = [&](const std::function<void(const inst_record &)> &f) {
+    if(ct) {
+      for(size_t i = 0, n = ct->size(); i < n; i++) {
+	f(ct->at(i));
+      }
+    }
+    else if(not(rt.get_records().empty())) {
+      for(const inst_record &ir : rt.get_records()) {
+	f(ir);
+      }
+    }
+    else {
+      std::unique_ptr<trace_reader> sr(open_trace_reader(input, threads));
+      std::vector<inst_record> chunk;
+      while(sr->read(chunk, chunk_size)) {
+	for(const inst_record &ir : chunk) {
+	  f(ir);
+	}
+	chunk.clear();
+      }
+    }
+  };
+
+  if(sp_interval) {
+    std::vector<uint32_t> block_of(prof.size(), r.size());
+    for(size_t b = 0; b < r.size(); b++) {
+      for(const auto &ins : r[b]->getVecIns()) {
+	block_of[ins.prof] = b;
+      }
+    }
+    simpoint sp(sp_interval, sp_dims, block_of, r.size(), sp_seed);
+    replay([&sp, &prof](const inst_record &ir) {
+	sp.add(prof.find(ir.pc));
+      });
+    std::vector<simpoint::point> pts = sp.pick(sp_max_k, sp_seed);
+    const std::string sp_name = input + "_simpoints.txt";
+    if(not(simpoint::write(sp_name, pts))) {
+      std::cout << "unable to write " << sp_name << "\n";
+      return -1;
+    }
+    std::cout << sp.num_intervals() << " intervals, "
+	      << pts.size() << " simpoints written to " << sp_name << "\n";
+  }
   
-  regionCFG *cfg = new regionCFG(input, rt.tip, counts, pt.get_records() );
-  cfg->buildCFG(r);
+  prof.set_tip(rt.tip);
+
+  if(callgraph) {
+    call_graph cg(prof);
+    replay([&cg](const inst_record &ir) {
+	cg.add(ir);
+      });
+    cg.finish();
+    const std::string cg_name = input + "_callgraph.txt";
+    if(not(cg.write(cg_name))) {
+      std::cout << "unable to write " << cg_name << "\n";
+      return -1;
+    }
+    std::cout << cg.num_funcs() << " functions, " << cg.num_edges()
+	      << " call edges written to " << cg_name << "\n";
+  }
+
+  if(region_pct > 0.0) {
+    double total = 0.0, covered = 0.0;
+    std::vector<hot_region> hot = formHotRegions(r, prof, start_pc, region_pct / 100.0, total);
+    size_t nb = 0;
+    for(const hot_region &h : hot) {
+      covered += h.cycles;
+      nb += h.blocks.size();
+    }
+    std::cout << hot.size() << " regions, " << nb << " of " << r.size()
+	      << " blocks, covering " << (total == 0.0 ? 0.0 : (100.0 * covered / total))
+	      << "% of TIP cycles\n";
+    buildHotRegions(hot, input, prof, pt.get_store(), region_threads);
+  }
+  else {
+    regionCFG *cfg = new regionCFG(input, prof, pt.get_store() );
+    cfg->buildCFG(r);
+  }
 
   std::ofstream out("blocks.txt");
-  for(auto p : basicBlock::bbMap) {
+  for(auto p : basicBlock::bbMap.sorted()) {
     out << *(p.second) << "\n";
   }  
   stopCapstone();
@@ -4,46 +4,36 @@
 
 void naturalLoop::print() const {
   printf("loop head %s\n", head->getName().c_str());
-  for(cfgBasicBlock *blk : loop) {
+  for(cfgBasicBlock *blk : blocks) {
     if(blk != head) printf("\t%s\n", blk->getName().c_str());
   }
+  for(naturalLoop *c : children) {
+    printf("\tloop %s\n", c->head->getName().c_str());
+  }
   printf("\n");
 }
 
-/* is other in loop? */
-bool naturalLoop::isNestedLoop(const naturalLoop &other) const {
-  for(auto bb : other.loop) {
-    if(loop.find(bb) == loop.end()) {
-      return false;
-    }
-  }
-  return true;
+void naturalLoop::addBlock(cfgBasicBlock *bb) {
+  blocks.push_back(bb);
+  bb->innerLoop = this;
+  numBlocks++;
+  double c = bb->computeTipCycles();
+  selfCycles += c;
+  cycles += c;
 }
 
-bool naturalLoop::isSameLoop(const naturalLoop &other) const {
-  if(other.loop.size() != loop.size()) {
-    return false;
-  }
-  for(auto bb : other.loop) {
-    if(loop.find(bb) == loop.end()) {
-      return false;
-    }
-  }
-  return true;
-}
-
-double naturalLoop::computeTipCycles() const {
-  double c = 0.0;
-  for(auto bb : loop) {
-    c += bb->computeTipCycles();
-  }
-  return c;
+/* l is complete, the forest is built inside out */
+void naturalLoop::addChild(naturalLoop *l) {
+  children.push_back(l);
+  l->parent = this;
+  numBlocks += l->numBlocks;
+  cycles += l->cycles;
 }
 
 void naturalLoop::emitGraphviz(int &l_id, std::ostream &out) const {
   out << "subgraph cluster_" << l_id << "{\n";
   out << "label = \"loop_" << l_id << "\"\n";
-  for(const auto *bb : getLoop()) {
+  for(const auto *bb : blocks) {
     out << "\"bb" << std::hex <<  bb->getEntryAddr() <<std::dec << "\"\n";
   }
 
@@ -1,35 +1,61 @@
 #ifndef __naturalLoophh__
 #define __naturalLoophh__
 
+/* a loop of the loop nesting forest (see regionCFG::findNaturalLoops) :
+ * the header, the blocks whose innermost loop this is and the loops
+ * nested directly inside. an irreducible loop is also entered other
+ * than through its header */
 class naturalLoop {
 private:
-  friend class sortNaturalLoops;
   cfgBasicBlock *head, *latch;
-  std::set<cfgBasicBlock*> loop;
-  std::list<naturalLoop*> children;
+  bool irreducible;
+  naturalLoop *parent = nullptr;
+  uint32_t depth = 0;
+  std::vector<cfgBasicBlock*> blocks;
+  std::vector<naturalLoop*> children;
+  /* over the nested loops too */
+  size_t numBlocks = 0;
+  double selfCycles = 0.0, cycles = 0.0;
 public:
-  naturalLoop(cfgBasicBlock *head, cfgBasicBlock *latch, std::set<cfgBasicBlock*> loop) :
-    head(head), latch(latch), loop(loop) {}
+  naturalLoop(cfgBasicBlock *head, cfgBasicBlock *latch, bool irreducible) :
+    head(head), latch(latch), irreducible(irreducible) {}
   bool inSingleBlockLoop(cfgBasicBlock *blk) {
-    if(loop.size() != 1)
+    if(numBlocks != 1)
       return false;
     return (head == blk);
   }
-  void addChild(naturalLoop *l) {
-    children.push_back(l);
-  }  
+  void addBlock(cfgBasicBlock *bb);
+  void addChild(naturalLoop *l);
+  void setDepth(uint32_t d) {
+    depth = d;
+  }
   bool operator<(const naturalLoop &other) const {
-    return loop.size() < other.loop.size();
+    return numBlocks < other.numBlocks;
+  }
+  const std::vector<cfgBasicBlock*> &getBlocks() const {
+    return blocks;
+  }
+  std::vector<naturalLoop*> &getChildren() {
+    return children;
+  }
+  const std::vector<naturalLoop*> &getChildren() const {
+    return children;
   }
-  const std::set<cfgBasicBlock*> &getLoop() const {
-    return loop;
+  naturalLoop *getParent() const {
+    return parent;
+  }
+  uint32_t getDepth() const {
+    return depth;
+  }
+  bool isIrreducible() const {
+    return irreducible;
   }
   uint64_t headPC() const {
     return head->getEntryAddr();
   }
   uint64_t headVPC() const {
     return head->getEntryVirtualAddr();
-  }  
+  }
   cfgBasicBlock* getHead() const {
     return head;
   }
@@ -37,22 +63,18 @@ public:
     return latch;
   }
   size_t size() const {
-    return loop.size();
+    return numBlocks;
+  }
+  /* TIP cycles of every block in the loop, and of its own blocks */
+  double computeTipCycles() const {
+    return cycles;
+  }
+  double selfTipCycles() const {
+    return selfCycles;
   }
-  double computeTipCycles() const;
   void print() const;
-  bool isNestedLoop(const naturalLoop &other) const;
-  bool isSameLoop(const naturalLoop &other) const;
   void emitGraphviz(int &l_id, std::ostream &out) const;
   bool isCountableLoop() const;
 };
 
-class sortNaturalLoops {
-public:
-  bool operator() (const naturalLoop *lhs, 
-		   const naturalLoop *rhs) const {
-    return lhs->loop.size() > rhs->loop.size();
-  }
-};
-
 #endif
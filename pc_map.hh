@@ -0,0 +1,244 @@
+#ifndef __pc_map_hh__
+#define __pc_map_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+/* open addressing tables keyed by pc for the lookups CFG
+ * construction does on every retired instruction : linear probing
+ * over a power of two array, ~0 marks an empty slot (never a pc)
+ * and erase shifts the rest of the probe run back rather than
+ * leaving tombstones */
+template <typename V>
+class pc_map {
+public:
+  static constexpr uint64_t empty_key = ~0UL;
+  struct entry {
+    uint64_t first;
+    V second;
+  };
+  template <typename E>
+  class iter {
+  private:
+    E *p, *e;
+    void skip() {
+      while((p != e) and (p->first == empty_key)) {
+	++p;
+      }
+    }
+  public:
+    iter(E *p, E *e) : p(p), e(e) {
+      skip();
+    }
+    E &operator*() const {
+      return *p;
+    }
+    E *operator->() const {
+      return p;
+    }
+    iter &operator++() {
+      ++p;
+      skip();
+      return *this;
+    }
+    bool operator==(const iter &o) const {
+      return p == o.p;
+    }
+    bool operator!=(const iter &o) const {
+      return p != o.p;
+    }
+  };
+  typedef iter<entry> iterator;
+  typedef iter<const entry> const_iterator;
+private:
+  std::vector<entry> tab;
+  size_t n = 0;
+  unsigned shift = 64;
+  size_t home(uint64_t k) const {
+    return (k * 0x9e3779b97f4a7c15UL) >> shift;
+  }
+  size_t probe(uint64_t k) const {
+    size_t m = tab.size() - 1, i = home(k);
+    while((tab[i].first != empty_key) and (tab[i].first != k)) {
+      i = (i + 1) & m;
+    }
+    return i;
+  }
+  void grow() {
+    std::vector<entry> old(tab.empty() ? 16 : 2*tab.size(), entry{empty_key, V()});
+    old.swap(tab);
+    shift = 64 - __builtin_ctzl(tab.size());
+    for(entry &e : old) {
+      if(e.first != empty_key) {
+	tab[probe(e.first)] = std::move(e);
+      }
+    }
+  }
+public:
+  size_t size() const {
+    return n;
+  }
+  bool empty() const {
+    return n == 0;
+  }
+  void clear() {
+    tab.clear();
+    n = 0;
+    shift = 64;
+  }
+  V *find(uint64_t k) {
+    if(tab.empty()) {
+      return nullptr;
+    }
+    entry &e = tab[probe(k)];
+    return (e.first == k) ? &e.second : nullptr;
+  }
+  const V *find(uint64_t k) const {
+    return const_cast<pc_map*>(this)->find(k);
+  }
+  V &operator[](uint64_t k) {
+    /* keep the load at or below 1/2 */
+    if(2*(n + 1) > tab.size()) {
+      grow();
+    }
+    entry &e = tab[probe(k)];
+    if(e.first == empty_key) {
+      e.first = k;
+      e.second = V();
+      n++;
+    }
+    return e.second;
+  }
+  bool erase(uint64_t k) {
+    if(tab.empty()) {
+      return false;
+    }
+    size_t m = tab.size() - 1, i = probe(k), j = i;
+    if(tab[i].first != k) {
+      return false;
+    }
+    while(true) {
+      j = (j + 1) & m;
+      if(tab[j].first == empty_key) {
+	break;
+      }
+      /* move tab[j] into the hole unless its home lies in (i, j] */
+      size_t h = home(tab[j].first);
+      bool stays = (i < j) ? ((h > i) and (h <= j)) : ((h > i) or (h <= j));
+      if(not(stays)) {
+	tab[i] = std::move(tab[j]);
+	i = j;
+      }
+    }
+    tab[i] = entry{empty_key, V()};
+    n--;
+    return true;
+  }
+  iterator begin() {
+    return iterator(tab.data(), tab.data() + tab.size());
+  }
+  iterator end() {
+    return iterator(tab.data() + tab.size(), tab.data() + tab.size());
+  }
+  const_iterator begin() const {
+    return const_iterator(tab.data(), tab.data() + tab.size());
+  }
+  const_iterator end() const {
+    return const_iterator(tab.data() + tab.size(), tab.data() + tab.size());
+  }
+  /* entries in pc order, for walks whose order shows in the output */
+  std::vector<entry> sorted() const {
+    std::vector<entry> v;
+    v.reserve(n);
+    for(const entry &e : *this) {
+      v.push_back(e);
+    }
+    std::sort(v.begin(), v.end(), [](const entry &a, const entry &b) {
+	return a.first < b.first;
+      });
+    return v;
+  }
+};
+
+/* (src pc, dst pc) -> count, the dynamic edge profile */
+class edge_map {
+private:
+  struct entry {
+    uint64_t src, dst, count;
+  };
+  std::vector<entry> tab;
+  size_t n = 0;
+  unsigned shift = 64;
+  size_t home(uint64_t src, uint64_t dst) const {
+    return ((src * 0x9e3779b97f4a7c15UL) ^ (dst * 0xc2b2ae3d27d4eb4fUL)) >> shift;
+  }
+  size_t probe(uint64_t src, uint64_t dst) const {
+    size_t m = tab.size() - 1, i = home(src, dst);
+    while((tab[i].src != pc_map<uint64_t>::empty_key) and
+	  ((tab[i].src != src) or (tab[i].dst != dst))) {
+      i = (i + 1) & m;
+    }
+    return i;
+  }
+  void grow() {
+    std::vector<entry> old(tab.empty() ? 16 : 2*tab.size(),
+			   entry{pc_map<uint64_t>::empty_key, 0, 0});
+    old.swap(tab);
+    shift = 64 - __builtin_ctzl(tab.size());
+    for(const entry &e : old) {
+      if(e.src != pc_map<uint64_t>::empty_key) {
+	tab[probe(e.src, e.dst)] = e;
+      }
+    }
+  }
+public:
+  size_t size() const {
+    return n;
+  }
+  void clear() {
+    tab.clear();
+    n = 0;
+    shift = 64;
+  }
+  /* size the table for m edges up front. filling a table from
+   * another one's for_each wants this : slot order is hash order,
+   * so growing while inserting in it piles the entries up into a
+   * few long probe runs */
+  void reserve(size_t m) {
+    while(2*m > tab.size()) {
+      grow();
+    }
+  }
+  uint64_t &operator()(uint64_t src, uint64_t dst) {
+    if(2*(n + 1) > tab.size()) {
+      grow();
+    }
+    entry &e = tab[probe(src, dst)];
+    if(e.src == pc_map<uint64_t>::empty_key) {
+      e = entry{src, dst, 0};
+      n++;
+    }
+    return e.count;
+  }
+  /* f(src, dst, count) for every edge, in table order */
+  template <typename F>
+  void for_each(F f) const {
+    for(const entry &e : tab) {
+      if(e.src != pc_map<uint64_t>::empty_key) {
+	f(e.src, e.dst, e.count);
+      }
+    }
+  }
+  uint64_t get(uint64_t src, uint64_t dst) const {
+    if(tab.empty()) {
+      return 0;
+    }
+    const entry &e = tab[probe(src, dst)];
+    return (e.src == src) ? e.count : 0;
+  }
+};
+
+#endif
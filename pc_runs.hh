@@ -0,0 +1,95 @@
+#ifndef __pc_runs_hh__
+#define __pc_runs_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <iterator>
+
+/* pc -> (owner, offset) for instructions held in owners' vectors,
+ * stored as runs of consecutive pcs at consecutive offsets of one
+ * owner. a lookup searches the runs, and handing part of an owner
+ * to another (a block split or merge) rewrites one entry per run
+ * instead of one per instruction */
+template <typename V>
+class pc_runs {
+public:
+  struct run {
+    uint64_t len;
+    V owner;
+    /* offset of the first instruction in the owner */
+    size_t offs;
+  };
+private:
+  typedef std::map<uint64_t, run> run_map;
+  run_map runs;
+  size_t n = 0;
+  /* run the last insert went to, inserts mostly extend it */
+  typename run_map::iterator last = runs.end();
+  typename run_map::iterator lookup(uint64_t pc) {
+    auto it = runs.upper_bound(pc);
+    if(it == runs.begin()) {
+      return runs.end();
+    }
+    --it;
+    uint64_t d = pc - it->first;
+    return ((d & 3) == 0) and ((d >> 2) < it->second.len) ? it : runs.end();
+  }
+  bool extends(typename run_map::iterator it, uint64_t pc, V owner, size_t offs) const {
+    return (it != runs.end()) and (it->second.owner == owner) and
+      ((it->first + 4*it->second.len) == pc) and
+      ((it->second.offs + it->second.len) == offs);
+  }
+public:
+  size_t size() const {
+    return n;
+  }
+  void clear() {
+    runs.clear();
+    n = 0;
+    last = runs.end();
+  }
+  V *find(uint64_t pc) {
+    auto it = lookup(pc);
+    return (it == runs.end()) ? nullptr : &it->second.owner;
+  }
+  /* also returns the offset of pc in its owner */
+  V *find(uint64_t pc, size_t &offs) {
+    auto it = lookup(pc);
+    if(it == runs.end()) {
+      return nullptr;
+    }
+    offs = it->second.offs + ((pc - it->first) >> 2);
+    return &it->second.owner;
+  }
+  /* pc must not be indexed yet */
+  void insert(uint64_t pc, V owner, size_t offs) {
+    n++;
+    if(not(extends(last, pc, owner, offs))) {
+      last = lookup(pc - 4);
+      if(not(extends(last, pc, owner, offs))) {
+	last = runs.emplace(pc, run{1, owner, offs}).first;
+	return;
+      }
+    }
+    last->second.len++;
+  }
+  /* hands pc and the rest of its run to owner at offset offs,
+   * returns how many instructions moved */
+  size_t reassign(uint64_t pc, V owner, size_t offs) {
+    auto it = lookup(pc);
+    uint64_t k = (pc - it->first) >> 2;
+    if(k != 0) {
+      run tail{it->second.len - k, owner, offs};
+      it->second.len = k;
+      it = runs.emplace_hint(std::next(it), pc, tail);
+    }
+    else {
+      it->second.owner = owner;
+      it->second.offs = offs;
+    }
+    return it->second.len;
+  }
+};
+
+#endif
@@ -159,20 +159,4 @@ public:
 };
 
 
-class pipeline_reader : public pipeline_data {
-public:
-  pipeline_reader() {}
-  
-  void read(const std::string &fname) {
-    std::ifstream ifs(fname, std::ios::binary);
-    boost::archive::binary_iarchive ia(ifs);
-    // read class state from archive
-    ia >> *this;
-    std::cout << "read " << records.size() << " records\n";
-  }
-  
-};
-
-
-
 #endif
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#include "pipeline_store.hh"
+#include "trace_reader.hh"
+
+void pipeline_store::delta_column::push_back(uint64_t v) {
+  size_t i = offs.size();
+  if((i % block) == 0) {
+    base.push_back(v);
+  }
+  uint64_t b = base.back();
+  if((v >= b) and ((v - b) < wide_marker)) {
+    offs.push_back(static_cast<uint32_t>(v - b));
+  }
+  else {
+    offs.push_back(wide_marker);
+    wide[i] = v;
+  }
+}
+
+uint32_t pipeline_store::intern(uint64_t pc, const std::string &s) {
+  auto it = pc_disasm.find(pc);
+  if(it != pc_disasm.end() and strings[it->second] == s) {
+    return it->second;
+  }
+  uint32_t id;
+  auto sit = string_ids.find(s);
+  if(sit == string_ids.end()) {
+    id = strings.size();
+    strings.push_back(s);
+    string_ids[s] = id;
+  }
+  else {
+    id = sit->second;
+  }
+  pc_disasm[pc] = id;
+  return id;
+}
+
+uint64_t pipeline_store::stage_cycle(size_t i, stage s) const {
+  uint32_t d = stages[s][i];
+  if(d == no_cycle) {
+    return ~0UL;
+  }
+  if(d == wide_cycle) {
+    return wide_stages.at(i*num_stages + s);
+  }
+  return fetch_cycles[i] + d;
+}
+
+void pipeline_store::append(const pipeline_record &r) {
+  size_t i = pcs.size();
+  pcs.push_back(r.pc);
+  disasm_ids.push_back(intern(r.pc, r.disasm));
+  faults.push_back(r.faulted);
+  uuids.push_back(r.uuid);
+  fetch_cycles.push_back(r.fetch_cycle);
+
+  const uint64_t c[num_stages] = {
+    r.alloc_cycle, r.sched_cycle, r.complete_cycle, r.retire_cycle,
+    r.p1_hit_cycle, r.p1_miss_cycle, r.l1d_replay
+  };
+  for(size_t s = 0; s < num_stages; s++) {
+    uint64_t d = c[s] - r.fetch_cycle;
+    if(c[s] == ~0UL) {
+      stages[s].push_back(no_cycle);
+    }
+    else if((c[s] >= r.fetch_cycle) and (d < wide_cycle)) {
+      stages[s].push_back(static_cast<uint32_t>(d));
+    }
+    else {
+      stages[s].push_back(wide_cycle);
+      wide_stages[i*num_stages + s] = c[s];
+    }
+  }
+
+  events.insert(events.end(), r.l1d_blocks.begin(), r.l1d_blocks.end());
+  events.insert(events.end(), r.l1d_sd.begin(), r.l1d_sd.end());
+  event_offs.push_back(events.size());
+  num_blocks.push_back(r.l1d_blocks.size());
+}
+
+void pipeline_store::shrink_to_fit() {
+  pcs.shrink_to_fit();
+  disasm_ids.shrink_to_fit();
+  faults.shrink_to_fit();
+  uuids.shrink_to_fit();
+  fetch_cycles.shrink_to_fit();
+  for(auto &v : stages) {
+    v.shrink_to_fit();
+  }
+  events.shrink_to_fit();
+  event_offs.shrink_to_fit();
+  num_blocks.shrink_to_fit();
+}
+
+void pipeline_store::index_pcs() {
+  pc_keys.clear();
+  pc_keys.reserve(pc_disasm.size());
+  for(const auto &p : pc_disasm) {
+    pc_keys.push_back(p.first);
+  }
+  std::sort(pc_keys.begin(), pc_keys.end());
+  /* counting sort of the ordinals by pc */
+  std::vector<uint32_t> key(pcs.size());
+  pc_offs.assign(pc_keys.size() + 1, 0);
+  for(size_t i = 0, n = pcs.size(); i < n; i++) {
+    key[i] = std::lower_bound(pc_keys.begin(), pc_keys.end(), pcs[i]) - pc_keys.begin();
+    pc_offs[key[i] + 1]++;
+  }
+  for(size_t k = 0, n = pc_keys.size(); k < n; k++) {
+    pc_offs[k + 1] += pc_offs[k];
+  }
+  std::vector<uint64_t> fill(pc_offs.begin(), pc_offs.end() - 1);
+  pc_ords.resize(pcs.size());
+  for(size_t i = 0, n = pcs.size(); i < n; i++) {
+    pc_ords[fill[key[i]]++] = i;
+  }
+}
+
+pipeline_store::ordinal_range pipeline_store::instances(uint64_t pc) const {
+  auto it = std::lower_bound(pc_keys.begin(), pc_keys.end(), pc);
+  if(it == pc_keys.end() or *it != pc) {
+    return ordinal_range{nullptr, nullptr};
+  }
+  size_t k = it - pc_keys.begin();
+  return ordinal_range{pc_ords.data() + pc_offs[k], pc_ords.data() + pc_offs[k+1]};
+}
+
+void pipeline_reader::read(const std::string &fname) {
+  using namespace boost::serialization;
+  std::ifstream ifs(fname, std::ios::binary);
+  boost::archive::binary_iarchive ia(ifs);
+  /* same layout pipeline_data::serialize writes */
+  archive_preamble<pipeline_data> pd_preamble;
+  archive_preamble<std::list<pipeline_record>> list_preamble;
+  ia >> pd_preamble;
+  ia >> list_preamble;
+  collection_size_type count;
+  ia >> count;
+  if(boost::archive::library_version_type(3) < ia.get_library_version()) {
+    item_version_type item_version(0);
+    ia >> item_version;
+  }
+  for(size_t i = 0; i < count; i++) {
+    pipeline_record r;
+    ia >> r;
+    store.append(r);
+  }
+  store.shrink_to_fit();
+  store.index_pcs();
+  std::cout << "read " << store.size() << " records\n";
+}
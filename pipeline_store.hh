@@ -0,0 +1,150 @@
+#ifndef __pipeline_store_hh__
+#define __pipeline_store_hh__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+
+#include "pipeline_record.hh"
+
+/* compact in-memory pipeline trace : one column per field,
+ * disasm interned per static pc, cycle counts held as 32-bit
+ * deltas and the l1d event lists flattened into one array */
+class pipeline_store {
+public:
+  /* values kept as a 32-bit offset from a per-block base,
+   * anything that doesn't fit spills to a side table */
+  class delta_column {
+  private:
+    static constexpr size_t block = 64;
+    static constexpr uint32_t wide_marker = ~0U;
+    std::vector<uint64_t> base;
+    std::vector<uint32_t> offs;
+    std::unordered_map<uint64_t, uint64_t> wide;
+  public:
+    void push_back(uint64_t v);
+    uint64_t operator[](size_t i) const {
+      uint32_t d = offs[i];
+      return (d == wide_marker) ? wide.at(i) : base[i / block] + d;
+    }
+    void shrink_to_fit() {
+      base.shrink_to_fit();
+      offs.shrink_to_fit();
+    }
+  };
+
+  struct event_range {
+    const uint64_t *b, *e;
+    const uint64_t *begin() const { return b; }
+    const uint64_t *end() const { return e; }
+    size_t size() const { return e - b; }
+  };
+  /* sorted record ordinals of one pc */
+  using ordinal_range = event_range;
+
+  /* cycle columns stored relative to fetch */
+  enum stage {alloc = 0, sched, complete, retire, p1_hit, p1_miss, l1d_replay, num_stages};
+private:
+  static constexpr uint32_t no_cycle = ~0U;
+  static constexpr uint32_t wide_cycle = ~0U - 1;
+
+  std::vector<std::string> strings;
+  std::unordered_map<std::string, uint32_t> string_ids;
+  std::unordered_map<uint64_t, uint32_t> pc_disasm;
+
+  std::vector<uint64_t> pcs;
+  std::vector<uint32_t> disasm_ids;
+  std::vector<uint8_t> faults;
+  delta_column uuids, fetch_cycles;
+  std::array<std::vector<uint32_t>, num_stages> stages;
+  std::unordered_map<uint64_t, uint64_t> wide_stages;
+  /* events for record i live in [event_offs[i], event_offs[i+1]),
+   * l1d_blocks first then l1d_sd */
+  std::vector<uint64_t> events;
+  std::vector<uint64_t> event_offs = {0};
+  std::vector<uint32_t> num_blocks;
+  /* pc -> ordinals, ordinals of pc_keys[k] live in
+   * [pc_ords[pc_offs[k]], pc_ords[pc_offs[k+1]]) */
+  std::vector<uint64_t> pc_keys;
+  std::vector<uint64_t> pc_offs;
+  std::vector<uint64_t> pc_ords;
+
+  uint32_t intern(uint64_t pc, const std::string &s);
+  uint64_t stage_cycle(size_t i, stage s) const;
+public:
+  void append(const pipeline_record &r);
+  void shrink_to_fit();
+  /* builds the pc index used by instances() */
+  void index_pcs();
+  size_t size() const {
+    return pcs.size();
+  }
+  bool empty() const {
+    return pcs.empty();
+  }
+  size_t num_disasm() const {
+    return strings.size();
+  }
+  uint64_t pc(size_t i) const {
+    return pcs[i];
+  }
+  uint64_t uuid(size_t i) const {
+    return uuids[i];
+  }
+  const std::string &disasm(size_t i) const {
+    return strings[disasm_ids[i]];
+  }
+  bool faulted(size_t i) const {
+    return faults[i] != 0;
+  }
+  uint64_t fetch_cycle(size_t i) const {
+    return fetch_cycles[i];
+  }
+  uint64_t alloc_cycle(size_t i) const {
+    return stage_cycle(i, alloc);
+  }
+  uint64_t sched_cycle(size_t i) const {
+    return stage_cycle(i, sched);
+  }
+  uint64_t complete_cycle(size_t i) const {
+    return stage_cycle(i, complete);
+  }
+  uint64_t retire_cycle(size_t i) const {
+    return stage_cycle(i, retire);
+  }
+  uint64_t p1_hit_cycle(size_t i) const {
+    return stage_cycle(i, p1_hit);
+  }
+  uint64_t p1_miss_cycle(size_t i) const {
+    return stage_cycle(i, p1_miss);
+  }
+  uint64_t l1d_replay_cycle(size_t i) const {
+    return stage_cycle(i, l1d_replay);
+  }
+  event_range l1d_blocks(size_t i) const {
+    const uint64_t *b = events.data() + event_offs[i];
+    return event_range{b, b + num_blocks[i]};
+  }
+  event_range l1d_sd(size_t i) const {
+    const uint64_t *b = events.data() + event_offs[i] + num_blocks[i];
+    return event_range{b, events.data() + event_offs[i+1]};
+  }
+  ordinal_range instances(uint64_t pc) const;
+};
+
+/* decodes a pipeline_logger archive one record at a time
+ * straight into a pipeline_store */
+class pipeline_reader {
+private:
+  pipeline_store store;
+public:
+  pipeline_reader() {}
+  void read(const std::string &fname);
+  const pipeline_store &get_store() const {
+    return store;
+  }
+};
+
+#endif
@@ -0,0 +1,15 @@
+#include <algorithm>
+
+#include "profile.hh"
+
+void pc_profile::set_tip(const std::map<int64_t, double> &tip) {
+  std::fill(cycles.begin(), cycles.end(), 0.0);
+  std::fill(tipped.begin(), tipped.end(), 0);
+  for(const auto &p : tip) {
+    uint32_t i = find(p.first);
+    if(i != no_index) {
+      cycles[i] = p.second;
+      tipped[i] = 1;
+    }
+  }
+}
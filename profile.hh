@@ -0,0 +1,76 @@
+#ifndef __profile_hh__
+#define __profile_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+
+#include "pc_map.hh"
+
+/* per static pc profile : a pc gets a dense index the first time
+ * the CFG build retires it, execution counts and tip cycles live
+ * in arrays indexed by it so reports don't walk trees */
+class pc_profile {
+public:
+  static constexpr uint32_t no_index = ~0U;
+private:
+  pc_map<uint32_t> index;
+  std::vector<uint64_t> pcs;
+  std::vector<uint64_t> counts;
+  std::vector<double> cycles;
+  std::vector<uint8_t> tipped;
+public:
+  uint32_t add(uint64_t pc) {
+    uint32_t &e = index[pc];
+    if(e != 0) {
+      return e - 1;
+    }
+    uint32_t i = pcs.size();
+    /* stored off by one so a fresh slot reads as unseen */
+    e = i + 1;
+    pcs.push_back(pc);
+    counts.push_back(0);
+    cycles.push_back(0.0);
+    tipped.push_back(0);
+    return i;
+  }
+  uint32_t find(uint64_t pc) const {
+    const uint32_t *e = index.find(pc);
+    return e ? (*e - 1) : no_index;
+  }
+  void retire(uint32_t i, uint64_t n = 1) {
+    counts[i] += n;
+  }
+  /* load tip cycles for every indexed pc, replacing earlier ones */
+  void set_tip(const std::map<int64_t, double> &tip);
+  size_t size() const {
+    return pcs.size();
+  }
+  uint64_t pc_at(uint32_t i) const {
+    return pcs[i];
+  }
+  uint64_t count_at(uint32_t i) const {
+    return counts[i];
+  }
+  double cycles_at(uint32_t i) const {
+    return cycles[i];
+  }
+  bool has_tip_at(uint32_t i) const {
+    return tipped[i] != 0;
+  }
+  /* cycles per retired instance */
+  double cpi_at(uint32_t i) const {
+    return cycles[i] / counts[i];
+  }
+  uint64_t count(uint64_t pc) const {
+    uint32_t i = find(pc);
+    return (i == no_index) ? 0 : counts[i];
+  }
+  double tip(uint64_t pc) const {
+    uint32_t i = find(pc);
+    return (i == no_index) ? 0.0 : cycles[i];
+  }
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include <cstdlib>
+#include <algorithm>
+
+#include "prune.hh"
+
+trace_pruner::trace_pruner(addr_class keep_class, uint64_t kernel_base,
+			   const std::vector<std::pair<uint64_t, uint64_t>> &firmware_ranges) :
+  keep_class(keep_class), kernel_base(kernel_base), firmware_ranges(firmware_ranges) {}
+
+bool trace_pruner::parse_class(const std::string &s, addr_class &c) {
+  if(s == "user") {
+    c = user;
+  }
+  else if(s == "kernel") {
+    c = kernel;
+  }
+  else if(s == "firmware") {
+    c = firmware;
+  }
+  else {
+    return false;
+  }
+  return true;
+}
+
+bool trace_pruner::parse_range(const std::string &s, std::pair<uint64_t, uint64_t> &r) {
+  size_t d = s.find('-');
+  if(d == std::string::npos) {
+    return false;
+  }
+  char *e = nullptr;
+  r.first = strtoull(s.c_str(), &e, 16);
+  if(e != s.c_str() + d) {
+    return false;
+  }
+  r.second = strtoull(s.c_str() + d + 1, &e, 16);
+  return (*e == '\0') and (r.first <= r.second);
+}
+
+trace_pruner::addr_class trace_pruner::classify(uint64_t vpc) const {
+  for(const auto &r : firmware_ranges) {
+    if((vpc >= r.first) and (vpc <= r.second)) {
+      return firmware;
+    }
+  }
+  return (vpc >= kernel_base) ? kernel : user;
+}
+
+void trace_pruner::close_window() {
+  if(in_window) {
+    windows.push_back(window{curr_start, n - curr_start, curr_pc});
+  }
+  in_window = false;
+}
+
+void trace_pruner::scan(const inst_record &r) {
+  if(fixed) {
+    while((next_fixed < windows.size()) and (windows[next_fixed].start == n)) {
+      windows[next_fixed++].pc = r.pc;
+    }
+    org_icnts[r.pc]++;
+    n++;
+    return;
+  }
+  bool k = (classify(r.vpc) == keep_class);
+  if(k and not(in_window)) {
+    curr_start = n;
+    curr_pc = r.pc;
+    in_window = true;
+  }
+  else if(not(k)) {
+    close_window();
+  }
+  org_icnts[r.pc]++;
+  n++;
+}
+
+std::vector<trace_pruner::window> trace_pruner::select(size_t top_k, uint64_t min_len) {
+  std::vector<window> w;
+  if(fixed) {
+    for(const window &x : windows) {
+      if(x.start < n) {
+	w.push_back(window{x.start, std::min(x.len, n - x.start), x.pc, x.weight});
+      }
+    }
+    return w;
+  }
+  close_window();
+  for(const window &x : windows) {
+    if(x.len >= std::max(min_len, static_cast<uint64_t>(1))) {
+      w.push_back(x);
+    }
+  }
+  /* longest first, earliest wins a tie */
+  std::stable_sort(w.begin(), w.end(), [](const window &a, const window &b) {
+      return a.len > b.len;
+    });
+  if(top_k and (w.size() > top_k)) {
+    w.resize(top_k);
+  }
+  std::sort(w.begin(), w.end(), [](const window &a, const window &b) {
+      return a.start < b.start;
+    });
+  return w;
+}
+
+void trace_pruner::rescale(const std::map<int64_t, double> &org_tip,
+			   std::map<int64_t, double> &tip) const {
+  /* scale tip data based on ratio of old icnt and new icnt */
+  for(const auto &p : new_icnts) {
+    auto it = org_tip.find(p.first);
+    if(it == org_tip.end()) {
+      continue;
+    }
+    uint64_t oc = org_icnts.at(p.first);
+    tip[p.first] = (it->second / oc) * p.second;
+  }
+}
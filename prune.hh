@@ -0,0 +1,72 @@
+#ifndef __prune_hh__
+#define __prune_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#include "inst_record.hh"
+
+/* splits a retire trace into maximal runs of records whose vpc
+ * falls in one address class and keeps the longest runs of the
+ * class asked for; tip is rescaled by how much of each pc's
+ * execution the kept windows cover */
+class trace_pruner {
+public:
+  enum addr_class {user = 0, kernel, firmware};
+  struct window {
+    uint64_t start, len;
+    /* pc of the first record */
+    uint64_t pc;
+    /* share of the trace an explicit window stands for */
+    double weight = 1.0;
+  };
+private:
+  addr_class keep_class;
+  uint64_t kernel_base;
+  std::vector<std::pair<uint64_t, uint64_t>> firmware_ranges;
+  uint64_t n = 0, curr_start = 0, curr_pc = 0;
+  bool in_window = false, fixed = false;
+  size_t next_fixed = 0;
+  std::vector<window> windows;
+  std::unordered_map<int64_t, uint64_t> org_icnts;
+  std::unordered_map<int64_t, double> new_icnts;
+  void close_window();
+public:
+  trace_pruner(addr_class keep_class, uint64_t kernel_base,
+	       const std::vector<std::pair<uint64_t, uint64_t>> &firmware_ranges);
+  static bool parse_class(const std::string &s, addr_class &c);
+  /* "lo-hi" in hex, both inclusive */
+  static bool parse_range(const std::string &s, std::pair<uint64_t, uint64_t> &r);
+  addr_class classify(uint64_t vpc) const;
+  /* explicit windows (e.g. simpoint slices) in trace order replace
+   * the address classes, scan() still fills in their pcs */
+  void set_windows(const std::vector<window> &w) {
+    windows = w;
+    fixed = true;
+  }
+  /* first pass, every record in trace order */
+  void scan(const inst_record &r);
+  /* once scanned : the longest top_k windows (all if zero) of at
+   * least min_len records, in trace order, or the explicit windows
+   * that fit in the trace */
+  std::vector<window> select(size_t top_k, uint64_t min_len);
+  /* once scanned : what each record of w counts for, its weight's
+   * share of the trace over its length for an explicit window, one
+   * for a window of the address class kept */
+  double scale(const window &w) const {
+    return fixed ? (w.weight * n / w.len) : 1.0;
+  }
+  /* second pass, every record inside a selected window, with that
+   * window's scale */
+  void keep(const inst_record &r, double s = 1.0) {
+    new_icnts[r.pc] += s;
+  }
+  void rescale(const std::map<int64_t, double> &org_tip,
+	       std::map<int64_t, double> &tip) const;
+};
+
+#endif
@@ -4,8 +4,12 @@
 #include <cassert>
 #include <regex>
 #include <limits>
+#include <numeric>
+#include <set>
+#include <unordered_set>
 #include <fstream>
-#include <boost/dynamic_bitset.hpp>
+#include <iomanip>
+#include <random>
 #include <fcntl.h>
 
 #include "regionCFG.hh"
@@ -13,10 +17,9 @@
 #include "helper.hh"
 #include "disassemble.hh"
 #include "globals.hh"
+#include "riscv.hh"
 
 
-static regionCFG *currCFG = nullptr;
-
 static void read_template(std::list<std::string> &pre,
 			  std::list<std::string> &post) {
   std::string line;
@@ -43,49 +46,44 @@ static void read_template(std::list<std::string> &pre,
 }
 
 static void dump_pipe(const std::string &oname,
-		      const std::list<pipeline_record> &pt,
+		      const pipeline_store &pt,
 		      uint64_t start, uint64_t stop) {
   std::list<std::string> pre, post, ops;
   read_template(pre, post);
-  
-  size_t cnt = 0;
-  for(auto &rec : pt) {
-    ++cnt;
-    if(cnt < start)
-      continue;
-    if(cnt > stop)
-      break;
+
+  /* start and stop are 1-based and inclusive */
+  for(size_t i = (start ? start-1 : 0), n = pt.size(); (i < n) and (i < stop); i++) {
     std::stringstream ss;
     ss << "{" << "\"str\":\""
-       << std::hex << rec.pc << std::dec
-       << " " << rec.disasm << "\""
+       << std::hex << pt.pc(i) << std::dec
+       << " " << pt.disasm(i) << "\""
        << ",uops:[{"
        << "\"uuid\":"
-       << "\"" << rec.uuid << "\","
+       << "\"" << pt.uuid(i) << "\","
        << "\"events\":{"
-       << "\"" << rec.fetch_cycle << "\":\"F\","
-       << "\"" << rec.alloc_cycle << "\":\"A\","
-       << "\"" << rec.sched_cycle << "\":\"S\",";
+       << "\"" << pt.fetch_cycle(i) << "\":\"F\","
+       << "\"" << pt.alloc_cycle(i) << "\":\"A\","
+       << "\"" << pt.sched_cycle(i) << "\":\"S\",";
 
-    for(uint64_t c : rec.l1d_blocks) {
+    for(uint64_t c : pt.l1d_blocks(i)) {
       ss << "\"" << c << "\":\"B\",";
     }
     
-    //for(uint64_t c : rec.l1d_sd) {
+    //for(uint64_t c : pt.l1d_sd(i)) {
     //  ss << "\"" << c << "\":\"Z\",";
     //}
 
-    if(rec.p1_hit_cycle != (~0UL)) {
-      ss << "\"" << rec.p1_hit_cycle << "\":\"H\",";
+    if(pt.p1_hit_cycle(i) != (~0UL)) {
+      ss << "\"" << pt.p1_hit_cycle(i) << "\":\"H\",";
     }
-    if(rec.p1_miss_cycle != (~0UL)) {
-      ss << "\"" << rec.p1_miss_cycle << "\":\"M\",";
+    if(pt.p1_miss_cycle(i) != (~0UL)) {
+      ss << "\"" << pt.p1_miss_cycle(i) << "\":\"M\",";
     }
-    if(rec.l1d_replay != (~0UL)) {
-      ss << "\"" << rec.l1d_replay << "\":\"L\",";
+    if(pt.l1d_replay_cycle(i) != (~0UL)) {
+      ss << "\"" << pt.l1d_replay_cycle(i) << "\":\"L\",";
     }
-    ss << "\"" << rec.complete_cycle << "\":\"C\","
-       << "\"" << rec.retire_cycle << "\":\"R\""                  
+    ss << "\"" << pt.complete_cycle(i) << "\":\"C\","
+       << "\"" << pt.retire_cycle(i) << "\":\"R\""                  
        << "}}]"
        << "}";
     ops.push_back(ss.str());
@@ -109,144 +107,26 @@ static void dump_pipe(const std::string &oname,
 }
 
 
-/* Implementation from Muchnick and Lengauer-Tarjan TOPLAS 
- * paper. Vague understanding from Appel. */
-class LengauerTarjanDominators {
-private:
-  std::vector<cfgBasicBlock*> &blocks;
-  cfgBasicBlock *root = nullptr;
-  ssize_t dfsCounter = 1;
-  /* Parent in the DFS tree */
-  std::map<cfgBasicBlock*, cfgBasicBlock*> Parent;
-  /* Ancestor chain in DFS tree */
-  std::map<cfgBasicBlock*, cfgBasicBlock*> Ancestor;
-  std::map<cfgBasicBlock*, cfgBasicBlock*> Label;
-  std::map<cfgBasicBlock*, std::set<cfgBasicBlock*>> Buckets;
-  std::map<ssize_t, cfgBasicBlock*> Ndfs;
-  std::map<cfgBasicBlock*, ssize_t> Sdno;
-  
-  void DFS(cfgBasicBlock *bb) {
-    Sdno.at(bb) = dfsCounter;
-    Ndfs[dfsCounter] = bb;
-    Label[bb] = bb;
-    Ancestor[bb] = nullptr;
-    dfsCounter++;
-    for(cfgBasicBlock *nbb : bb->getSuccs()) {
-      if(Sdno.at(nbb) == 0) {
-	Parent[nbb] = bb;
-	DFS(nbb);
-      }
-    }
-  }
-  /* these methods are from Lengauer-Tarjan paper
-   * and implement O(n*lg(n)) scheme */
-  void Link(cfgBasicBlock *v, cfgBasicBlock *w) {
-    Ancestor.at(w) = v;
-  }
-  void Compress(cfgBasicBlock *bb) {
-    if(Ancestor.at(Ancestor.at(bb))) {
-      Compress(Ancestor.at(bb));
-      if(Sdno.at(Label.at(Ancestor.at(bb))) < Sdno.at(Label.at(bb))) {
-	Label.at(bb) = Label.at(Ancestor.at(bb));
-      }
-      Ancestor.at(bb) = Ancestor.at(Ancestor.at(bb));
-    }
-  }
-  cfgBasicBlock *Eval(cfgBasicBlock *bb) {
-    if(!Ancestor.at(bb)) {
-      return bb;
-    }
-    else {
-      Compress(bb);
-      return Label.at(bb);
-    }
-  }
-  
-public:
-  LengauerTarjanDominators(std::vector<cfgBasicBlock*> &blocks) : blocks(blocks) {}
-  void operator()() {
-    for(cfgBasicBlock *bb : blocks) {
-      if(bb->getPreds().empty()) {
-	assert(root==nullptr);
-	root = bb;
-      }
-      Sdno[bb] = 0;
-      Parent[bb] = nullptr;
-      bb->getIdom() = nullptr;
-    }
-    assert(root);
-    DFS(root);
-    
-    for(ssize_t i = (dfsCounter-1); i > 1; i--) {
-      cfgBasicBlock *w = Ndfs.at(i);
-      ssize_t &sdom_w = Sdno.at(w);
-      for(cfgBasicBlock *pbb : w->getPreds()) {
-	cfgBasicBlock *u = Eval(pbb);
-	ssize_t sdom_u = Sdno.at(u);
-	if(sdom_u < sdom_w) {
-	  sdom_w = sdom_u;
-	}
-      }
-      Buckets[Ndfs.at(sdom_w)].insert(w);
-      Link(Parent.at(w), w);
-      /* need to understand - why parent bucket? */
-      std::set<cfgBasicBlock*> &pBucket = Buckets[Parent.at(w)];
-      for(cfgBasicBlock *v : pBucket) {
-	/* find ancestor with lowest semidominator */
-	cfgBasicBlock *u = Eval(v);
-	if(Sdno.at(u) < Sdno.at(v)) {
-	  /* idom is the semidominator */
-	  v->getIdom() = u;
-	}
-	else {
-	  /* must defer */
-	  v->getIdom() = Parent.at(w);
-	}
-      }
-      pBucket.clear();
-    }
-    for(ssize_t i = 2; i < dfsCounter; i++) {
-      cfgBasicBlock *w = Ndfs.at(i);
-      if(w->getIdom() != Ndfs.at(Sdno.at(w))) {
-	w->getIdom() = w->getIdom()->getIdom();
-      }
-    }
-    for(cfgBasicBlock *bb : blocks) {
-      if(bb->getPreds().empty()) {
-	continue;
-      }
-      bb->getIdom()->addDTreeSucc(bb);
-    }
-  }
-  
-};
-
-
-template <typename T>
-class sortByIcnt {
-public:
-  bool operator() (const T& lhs, const T& rhs) const {
-    return lhs->getInscnt() > rhs->getInscnt();
-  }
-};
-
-
-template <typename T>
-void inducePhis(const std::set<cfgBasicBlock*> &defBBs, int id) {
+/* phis go on the iterated frontier of the defs, the frontier is
+ * followed through the blocks where place says no */
+template <typename T, typename P>
+void inducePhis(const cfgBlockSet &defBBs, int id, size_t nBlocks,
+		ir_arena &arena, P place) {
   std::list<cfgBasicBlock*> workList;
-  std::set<cfgBasicBlock*> checkSet;
+  std::vector<bool> checkSet(nBlocks, false);
   for(cfgBasicBlock* cbb : defBBs) { 
     workList.push_back(cbb); 
-    checkSet.insert(cbb); 
+    checkSet[cbb->id] = true;
   }
   while(not(workList.empty()))  {
     cfgBasicBlock *cbb = workList.front();
     workList.pop_front();
     for(cfgBasicBlock* dbb : cbb->dfrontier) {
-      T* phi = new T(id);
-      dbb->addPhiNode(phi);
-      if(checkSet.find(dbb) == checkSet.end()) {
-	checkSet.insert(dbb);
+      if((dbb->gprPhis[id] == nullptr) and place(dbb)) {
+	dbb->addPhiNode(arena.make<T>(id));
+      }
+      if(not(checkSet[dbb->id])) {
+	checkSet[dbb->id] = true;
 	workList.push_back(dbb);
       }
     }
@@ -269,39 +149,89 @@ void ssaRegTables::copy(const ssaRegTables &other) {
 
 void regionCFG::getRegDefBlocks() {
   for(auto cbb : cfgBlocks) {
+    std::bitset<32> read;
     for(size_t i = 0, n = cbb->insns.size(); i < n; i++) {
       Insn *ins = cbb->insns[i];
-      ins->recDefines(cbb, this);
+      /* an instruction reads its sources before it writes */
+      cbb->gprRead.reset();
       ins->recUses(cbb);
+      cbb->gprUpExposed |= cbb->gprRead & ~cbb->gprWritten;
+      read |= cbb->gprRead;
+      ins->recDefines(cbb, this);
     }
+    cbb->gprRead = read;
     /* Union bitvectors */
-    for(size_t i = 0; i < 32; i++) {
-      allGprRead[i] = allGprRead[i] or cbb->gprRead[i];
+    allGprRead |= cbb->gprRead;
+    allGprUpExposed |= cbb->gprUpExposed;
+  }
+}
+
+/* backwards dataflow to a fixed point, blocks visited in post-order so
+ * most see their successors' final live in on the first pass */
+void regionCFG::computeLiveness() {
+  std::vector<uint32_t> order;
+  std::vector<bool> seen(cfgBlocks.size(), false);
+  std::vector<std::pair<uint32_t, const uint32_t*>> stack;
+  for(cfgBasicBlock *root : cfgBlocks) {
+    if(seen[root->id]) {
+      continue;
+    }
+    seen[root->id] = true;
+    stack.emplace_back(root->id, graph.succs(root->id).begin());
+    while(not(stack.empty())) {
+      uint32_t v = stack.back().first;
+      if(stack.back().second == graph.succs(v).end()) {
+	order.push_back(v);
+	stack.pop_back();
+	continue;
+      }
+      uint32_t w = *(stack.back().second++);
+      if(not(seen[w])) {
+	seen[w] = true;
+	stack.emplace_back(w, graph.succs(w).begin());
+      }
+    }
+  }
+  bool changed = true;
+  while(changed) {
+    changed = false;
+    for(uint32_t v : order) {
+      cfgBasicBlock *cbb = cfgBlocks[v];
+      std::bitset<32> out;
+      for(uint32_t s : graph.succs(v)) {
+	out |= cfgBlocks[s]->gprLiveIn;
+      }
+      std::bitset<32> in = cbb->gprUpExposed | (out & ~cbb->gprWritten);
+      cbb->gprLiveOut = out;
+      if(in != cbb->gprLiveIn) {
+	cbb->gprLiveIn = in;
+	changed = true;
+      }
     }
   }
 }
 
 bool regionCFG::allBlocksReachable(cfgBasicBlock *root) {
   std::queue<cfgBasicBlock*> q;
-  std::set<cfgBasicBlock*> v;
-  std::list<cfgBasicBlock*> l;
+  std::vector<bool> v(cfgBlocks.size(), false);
+  size_t reached = 0;
   
   q.push(root);
   while(not(q.empty())) {
     cfgBasicBlock *cbb = q.front();
     q.pop();
-    if(v.find(cbb) != v.end())
+    if(v[cbb->id])
       continue;
-    v.insert(cbb);
-    l.push_back(cbb);
+    v[cbb->id] = true;
+    reached++;
     for(auto nbb : cbb->succs) {
       q.push(nbb);
     }
   }
 
   for(auto bb : cfgBlocks) {
-    if(v.find(bb) == v.end()) {
-      std::cout << "couldnt reach block "
+    if(not(v[bb->id])) {
+      *log << "couldnt reach block "
 		<< std::hex
 		<< bb->getEntryAddr()
 		<< std::dec
@@ -312,7 +242,7 @@ bool regionCFG::allBlocksReachable(cfgBasicBlock *root) {
   print_var(v.size());
   print_var(cfgBlocks.size());
   */
-  return v.size() == cfgBlocks.size();
+  return reached == cfgBlocks.size();
 }
 
 template <bool use_succs>
@@ -331,13 +261,10 @@ static void dfs(basicBlock *bb, std::set<basicBlock*> &seen, std::list<basicBloc
 }
 
 bool regionCFG::buildCFG(std::vector<basicBlock*> &region) {
-  std::map<basicBlock*, cfgBasicBlock*> cfgMap;
-  std::vector<basicBlock*> blockvec;
   std::set<basicBlock*> discovered; 
   std::list<basicBlock*> visited;
   std::set<basicBlock*> seen;
   
-  currCFG = this;
   size_t maxInsnInBB = 0;
   head = nullptr;
   for(size_t j = 0, nn=region.size(); j < nn; j++) {
@@ -353,7 +280,7 @@ bool regionCFG::buildCFG(std::vector<basicBlock*> &region) {
     blocks.insert(bb);
     maxInsnInBB = std::max(maxInsnInBB, bb->getNumIns());
   }
-  std::cout << maxInsnInBB << " max instructions in a bb\n";
+  *log << maxInsnInBB << " max instructions in a bb\n";
   
   if(head==nullptr) {
     std::set<basicBlock*> succs_seen, preds_seen;
@@ -396,7 +323,7 @@ bool regionCFG::buildCFG(std::vector<basicBlock*> &region) {
       dfs<true>(bb, seen, finish);
       if(seen.size() > max_reachable) {
 	max_reachable = seen.size();
-	std::cout << "max_reachable = " << max_reachable << "\n";
+	*log << "max_reachable = " << max_reachable << "\n";
 	best = bb;
       }
     }
@@ -412,22 +339,45 @@ bool regionCFG::buildCFG(std::vector<basicBlock*> &region) {
   }
     
   if(head == nullptr) {
-    std::cout << "head is still nullptr\n";
+    *log << "head is still nullptr\n";
     die();
   }
+  return buildFromHead({});
+}
 
-  
-  std::cerr << "regionCFG block @ 0x"
-	    << std::hex << head->getEntryAddr()
-	    << std::dec
-	    << " with " << blocks.size()
-	    << " basicblocks\n";
+bool regionCFG::buildCFG(std::vector<basicBlock*> &region, basicBlock *entry,
+			 const std::vector<std::pair<basicBlock*, basicBlock*>> &extra) {
+  head = entry;
+  size_t maxInsnInBB = 0;
+  for(basicBlock *bb : region) {
+    blocks.insert(bb);
+    maxInsnInBB = std::max(maxInsnInBB, bb->getNumIns());
+  }
+  *log << maxInsnInBB << " max instructions in a bb\n";
+  return buildFromHead(extra);
+}
+
+bool regionCFG::buildFromHead(const std::vector<std::pair<basicBlock*, basicBlock*>> &extra) {
+  std::map<basicBlock*, cfgBasicBlock*> cfgMap;
+  std::vector<basicBlock*> blockvec;
+  /* one write, so lines from regions built side by side don't interleave */
+  std::stringstream ss;
+  ss << "regionCFG block @ 0x"
+     << std::hex << head->getEntryAddr()
+     << std::dec
+     << " with " << blocks.size()
+     << " basicblocks\n";
+  std::cerr << ss.str();
 
   blockvec.reserve(blocks.size());
   for(auto bb : blocks) {
     blockvec.push_back(bb);
   }
-  std::sort(blockvec.begin(), blockvec.end(), sortByIcnt<basicBlock*>());
+  /* block ids follow entry addresses */
+  std::sort(blockvec.begin(), blockvec.end(),
+	    [](const basicBlock *a, const basicBlock *b) {
+	      return a->getEntryAddr() < b->getEntryAddr();
+	    });
    
   for(auto bb : blocks) {
     bb->cfgCplr = this;
@@ -435,16 +385,15 @@ bool regionCFG::buildCFG(std::vector<basicBlock*> &region) {
   }  
   
   
-  for(auto bb : blocks) {
-    cfgBasicBlock *cbb = new cfgBasicBlock(bb);
+  for(auto bb : blockvec) {
+    cfgBasicBlock *cbb = newBlock(bb);
     if(bb == head) {
       cfgHead = cbb;
     }
-    cfgBlocks.push_back(cbb);
     cfgMap[bb] = cbb;
   }
   
-  for(auto bb : blocks) {
+  for(auto bb : blockvec) {
     for(auto nbb : bb->getSuccs()) {
       auto it = cfgMap.find(nbb);
       if(it != cfgMap.end()) {
@@ -452,6 +401,12 @@ bool regionCFG::buildCFG(std::vector<basicBlock*> &region) {
       }
     }
   }
+  for(const auto &e : extra) {
+    auto src = cfgMap.find(e.first), dst = cfgMap.find(e.second);
+    if((src != cfgMap.end()) and (dst != cfgMap.end())) {
+      src->second->addSuccessor(dst->second);
+    }
+  }
  
 
   /* "compile" mips instructions into proper class */
@@ -482,22 +437,17 @@ bool regionCFG::buildCFG(std::vector<basicBlock*> &region) {
   
   bool rc = analyzeGraph();
   if(not(rc) and globals::verbose) {
-    std::cout << "COMPILE FAILED  in analysis\n";
+    *log << "COMPILE FAILED  in analysis\n";
   }
   return rc;
 }
 
 bool regionCFG::analyzeGraph() {
-  entryBlock = new cfgBasicBlock(nullptr);
-  cfgBlocks.push_back(entryBlock);
+  entryBlock = newBlock(nullptr);
   entryBlock->addSuccessor(cfgHead);
+  buildGraph();
   
-  if(cfgBlocks.size() < 512) {
-    computeDominance();
-  }
-  else {
-    computeLengauerTarjanDominance();
-  }
+  computeDominance();
 
   fastDominancePreComputation();
   
@@ -505,13 +455,11 @@ bool regionCFG::analyzeGraph() {
   /* search for natural loops */
   findNaturalLoops();
 
+  computePostDominance();
+  computeControlDependence();
+
   //printNaturalLoops();
   
-  /* "compile" mips instructions into proper class */
-  for(size_t i = 0, n = cfgBlocks.size(); i < n; i++) {
-    cfgBasicBlock *cbb = cfgBlocks[i];
-    cbb->bindInsns(this);
-  }
 
   /* insert phis into basicblocks */
   insertPhis();
@@ -524,23 +472,49 @@ bool regionCFG::analyzeGraph() {
   entryBlock->traverseAndRename(this);
   entryBlock->patchUpPhiNodes(this);
 
-  /* will generate phis with no uses, just erase them */
+  /* will generate phis nothing reads. a phi is live if an instruction
+   * reads it or a live phi does, the others are unlinked from the
+   * values they read and erased. the phis lead ssaInsns in phiNodes
+   * order (traverseAndRename) */
+  std::vector<phiNode*> work;
+  std::unordered_set<const ssaInsn*> livePhis;
   for(cfgBasicBlock *bb : cfgBlocks) {
-    for(auto it = bb->phiNodes.begin(); it != bb->phiNodes.end(); ) {
-      phiNode *phi = *it;
-      if(phi->noUses()) {
-	//std::cout << phi->getName() << " : this phi has no uses\n";
-	it = bb->phiNodes.erase(it);
-	auto it2 = std::find(bb->ssaInsns.begin(), bb->ssaInsns.end(),
-			     static_cast<ssaInsn*>(phi));
-	assert(it2 != bb->ssaInsns.end());
-	bb->ssaInsns.erase(it2);
-	delete phi;	
+    for(phiNode *phi : bb->phiNodes) {
+      for(const ssaInsn *u : phi->getUses()) {
+	if(dynamic_cast<const phiNode*>(u) == nullptr) {
+	  livePhis.insert(phi);
+	  work.push_back(phi);
+	  break;
+	}
       }
-      else {
-	it++;
+    }
+  }
+  while(not(work.empty())) {
+    phiNode *phi = work.back();
+    work.pop_back();
+    for(auto &e : phi->getInBoundEdges()) {
+      phiNode *src = dynamic_cast<phiNode*>(e.second);
+      if(src and livePhis.insert(src).second) {
+	work.push_back(src);
+      }
+    }
+  }
+  for(cfgBasicBlock *bb : cfgBlocks) {
+    size_t n = bb->phiNodes.size(), k = 0;
+    for(size_t i = 0; i < n; i++) {
+      phiNode *phi = bb->phiNodes[i];
+      assert(bb->ssaInsns[i] == phi);
+      if(livePhis.count(phi) == 0) {
+	phi->unlink();
+	bb->gprPhis[phi->destRegister()] = nullptr;
+	continue;
       }
+      bb->phiNodes[k] = phi;
+      bb->ssaInsns[k] = phi;
+      k++;
     }
+    bb->phiNodes.resize(k);
+    bb->ssaInsns.erase(bb->ssaInsns.begin() + k, bb->ssaInsns.begin() + n);
   }
   
  
@@ -548,15 +522,16 @@ bool regionCFG::analyzeGraph() {
   dumpRISCV();
   asDot();
   asText();
+  writeBranchReport();
+  writeLoopReport();
   
   return true;
 }
 
 regionCFG::regionCFG(std::string name,
-		     std::map<int64_t, double> &tip,
-		     std::map<uint64_t, uint64_t> &counts,
-		     std::list<pipeline_record> &r) :
-  execUnit(), name(name), tip(tip), counts(counts), pt(r) {
+		     const pc_profile &prof,
+		     const pipeline_store &r) :
+  execUnit(), name(name), prof(prof), pt(r) {
   regionCFGs.insert(this);
   perfectNest = true;
   innerPerfectBlock = 0;
@@ -572,25 +547,57 @@ regionCFG::~regionCFG() {
     delete l;
   }
   regionCFGs.erase(regionCFGs.find(this));
-  
-  for(auto cblk : cfgBlocks) {
-    delete cblk;
-  }
   cfgBlocks.clear();
+  arena.clear();
+}
 
-  
+cfgBasicBlock *regionCFG::newBlock(basicBlock *bb) {
+  arena.emplace_back(bb);
+  cfgBasicBlock *cbb = &arena.back();
+  cbb->id = cfgBlocks.size();
+  cfgBlocks.push_back(cbb);
+  return cbb;
+}
+
+void regionCFG::buildGraph() {
+  auto byId = [](const cfgBasicBlock *a, const cfgBasicBlock *b) {
+    return a->id < b->id;
+  };
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  for(cfgBasicBlock *cbb : cfgBlocks) {
+    std::sort(cbb->succs.begin(), cbb->succs.end(), byId);
+    std::sort(cbb->preds.begin(), cbb->preds.end(), byId);
+    for(cfgBasicBlock *nbb : cbb->succs) {
+      edges.emplace_back(cbb->id, nbb->id);
+    }
+  }
+  graph.build(cfgBlocks.size(), edges);
 }
 
  
+bool regionCFG::parseSSAForm(const std::string &s, ssaForm &f) {
+  static const std::map<std::string, ssaForm> forms = {
+    {"minimal", ssaForm::minimal},
+    {"semi-pruned", ssaForm::semi_pruned},
+    {"pruned", ssaForm::pruned}
+  };
+  auto it = forms.find(s);
+  if(it == forms.end()) {
+    return false;
+  }
+  f = it->second;
+  return true;
+}
+
 void regionCFG::insertPhis()  {
   /* find blocks where registers are "defined" */
   getRegDefBlocks();
   /* if any register is written in the cfg */
   if(not(gprDefinitionBlocks[0].empty())) {
-    std::cout << "writing to the zero reg?\n";
+    *log << "writing to the zero reg?\n";
     for(cfgBasicBlock *bb : gprDefinitionBlocks[0]) {
 
-      std::cout << "this block writes zero reg?\n"
+      *log << "this block writes zero reg?\n"
 		<< *bb << "\n";
     }
   }
@@ -601,28 +608,188 @@ void regionCFG::insertPhis()  {
       gprDefinitionBlocks[gpr].insert(entryBlock);
     }
   }
+  if(phiPlacement == ssaForm::pruned) {
+    computeLiveness();
+  }
   /* handle gprs */
   for(size_t gpr = 1; gpr < 32; gpr++) {
-    inducePhis<gprPhiNode>(gprDefinitionBlocks[gpr], gpr);
+    if((phiPlacement == ssaForm::semi_pruned) and not(allGprUpExposed[gpr])) {
+      continue;
+    }
+    inducePhis<gprPhiNode>(gprDefinitionBlocks[gpr], gpr, cfgBlocks.size(), irArena,
+			   [gpr](const cfgBasicBlock *cbb) {
+			     return (phiPlacement != ssaForm::pruned) or cbb->gprLiveIn[gpr];
+			   });
   }
 }
 
-void regionCFG::fastDominancePreComputation() {
-  using namespace std;
-  size_t cnt = 0;
-  /* run DFS on the dominator tree */
-  function<void(cfgBasicBlock*)> dfs =[&](cfgBasicBlock* bb) {
-    cnt++;
-    /* pre-order - get dfnum */
-    bb->dt_dfn = cnt;
-    for(auto nbb : bb->getDTSuccs()) {
-      /* dom-tree .. no cycles */
-      dfs(nbb);
-    }
-    /* post-order - max dfnum of successors */
-    bb->dt_max_ancestor_dfn = cnt;
+/* numbers the dominator subtree at root in pre-order, spread evenly
+ * over [lo, hi], and sets the depths below root. false, numbering
+ * nothing, when the subtree has more blocks than numbers */
+bool regionCFG::numberDTree(cfgBasicBlock *root, ssize_t lo, ssize_t hi) {
+  struct item {
+    cfgBasicBlock *bb;
+    size_t child, pos;
   };
-  dfs(entryBlock);
+  /* pre-order, last[i] is the last block in order[i]'s subtree */
+  std::vector<cfgBasicBlock*> order(1, root);
+  std::vector<size_t> last(1, 0);
+  std::vector<item> stack(1, item{root, 0, 0});
+  while(not(stack.empty())) {
+    item &t = stack.back();
+    if(t.child == t.bb->dtree_succs.size()) {
+      last[t.pos] = order.size() - 1;
+      stack.pop_back();
+      continue;
+    }
+    cfgBasicBlock *c = t.bb->dtree_succs[t.child++];
+    stack.push_back(item{c, 0, order.size()});
+    order.push_back(c);
+    last.push_back(0);
+  }
+  size_t m = order.size();
+  if((hi < lo) or (static_cast<size_t>(hi - lo + 1) < m)) {
+    return false;
+  }
+  /* floor(i * (hi - lo + 1) / m) without the product */
+  const size_t q = static_cast<size_t>(hi - lo + 1) / m, r = static_cast<size_t>(hi - lo + 1) % m;
+  auto number = [lo, q, r, m](size_t i) {
+    return lo + static_cast<ssize_t>(i * q + (i * r) / m);
+  };
+  for(size_t i = 0; i < m; i++) {
+    cfgBasicBlock *bb = order[i];
+    bb->dt_dfn = number(i);
+    bb->dt_max_ancestor_dfn = number(last[i]);
+    if(i) {
+      bb->dt_depth = bb->idombb->dt_depth + 1;
+    }
+  }
+  /* the spare numbers stay with root */
+  root->dt_max_ancestor_dfn = hi;
+  return true;
+}
+
+/* blocks in the dominator subtree at root */
+static size_t dtreeSize(const cfgBasicBlock *root) {
+  std::vector<const cfgBasicBlock*> stack(1, root);
+  size_t m = 0;
+  while(not(stack.empty())) {
+    const cfgBasicBlock *bb = stack.back();
+    stack.pop_back();
+    m++;
+    stack.insert(stack.end(), bb->dtree_succs.begin(), bb->dtree_succs.end());
+  }
+  return m;
+}
+
+/* renumbers the smallest dominator subtree holding bb with at least
+ * dtGap / 2 numbers a block, the whole tree when none has, so the
+ * whole tree is renumbered once per doubling. the count grows on the
+ * way up, each block is counted once */
+void regionCFG::renumberDTree(cfgBasicBlock *bb) {
+  size_t m = dtreeSize(bb);
+  for(cfgBasicBlock *prev = nullptr, *r = bb; r != nullptr; prev = r, r = r->idombb) {
+    if(prev) {
+      m++;
+      for(const cfgBasicBlock *c : r->dtree_succs) {
+	if(c != prev) {
+	  m += dtreeSize(c);
+	}
+      }
+    }
+    if((m * (dtGap / 2)) <= static_cast<size_t>(r->dt_max_ancestor_dfn - r->dt_dfn + 1)) {
+      numberDTree(r, r->dt_dfn, r->dt_max_ancestor_dfn);
+      return;
+    }
+  }
+  fastDominancePreComputation();
+}
+
+/* gives bb the numbers after its own that its idom holds spare, false
+ * when there are none */
+bool regionCFG::growDTree(cfgBasicBlock *bb) {
+  const cfgBasicBlock *d = bb->idombb;
+  if(d == nullptr) {
+    return false;
+  }
+  ssize_t hi = d->dt_max_ancestor_dfn;
+  for(const cfgBasicBlock *c : d->dtree_succs) {
+    if(c->dt_dfn > bb->dt_max_ancestor_dfn) {
+      hi = std::min(hi, c->dt_dfn - 1);
+    }
+  }
+  if(hi <= bb->dt_max_ancestor_dfn) {
+    return false;
+  }
+  bb->dt_max_ancestor_dfn = hi;
+  return true;
+}
+
+/* numbers the dominator subtrees at the last k children of p in the
+ * longest run of p's numbers the others leave spare, p first growing
+ * when the run is too short. they take the middle half of the run,
+ * at most dtGap numbers a block, so its ends stay spare for later
+ * ones. renumbers around p when they still don't fit. children are
+ * kept in number order, as numberDTree leaves them */
+void regionCFG::placeDTrees(cfgBasicBlock *p, size_t k) {
+  std::vector<cfgBasicBlock*> &ds = p->dtree_succs;
+  const size_t n = ds.size() - k;
+  std::vector<size_t> sizes;
+  size_t total = 0;
+  for(size_t i = n; i < ds.size(); i++) {
+    sizes.push_back(dtreeSize(ds[i]));
+    total += sizes.back();
+  }
+  ssize_t lo = 0, hi = -1;
+  auto longest = [&]() {
+    lo = 0;
+    hi = -1;
+    ssize_t from = p->dt_dfn + 1;
+    auto run = [&](ssize_t a, ssize_t b) {
+      if((b - a) > (hi - lo)) {
+	lo = a;
+	hi = b;
+      }
+    };
+    for(size_t i = 0; i < n; i++) {
+      run(from, ds[i]->dt_dfn - 1);
+      from = ds[i]->dt_max_ancestor_dfn + 1;
+    }
+    run(from, p->dt_max_ancestor_dfn);
+  };
+  const ssize_t need = total;
+  longest();
+  if(((hi - lo + 1) < need) and growDTree(p)) {
+    longest();
+  }
+  if((hi - lo + 1) < need) {
+    renumberDTree(p);
+    return;
+  }
+  const size_t run = hi - lo + 1;
+  const size_t len = ((run / 2) < total) ? run : std::min<size_t>(run / 2, dtGap * total);
+  lo += static_cast<ssize_t>((run - len) / 2);
+  const size_t q = len / total, r = len % total;
+  size_t cum = 0;
+  for(size_t i = 0; i < k; i++) {
+    ssize_t a = lo + static_cast<ssize_t>(cum * q + (cum * r) / total);
+    cum += sizes[i];
+    ssize_t b = lo + static_cast<ssize_t>(cum * q + (cum * r) / total) - 1;
+    ds[n + i]->dt_depth = p->dt_depth + 1;
+    numberDTree(ds[n + i], a, b);
+  }
+  std::inplace_merge(ds.begin(), ds.begin() + n, ds.end(),
+		     [](const cfgBasicBlock *x, const cfgBasicBlock *y) {
+		       return x->dt_dfn < y->dt_dfn;
+		     });
+}
+
+void regionCFG::fastDominancePreComputation() {
+  /* Appel exercise 19.1, pre-order numbers with dtGap numbers per
+   * block so splits and moved subtrees mostly find spare numbers
+   * where they land, see placeDTrees */
+  entryBlock->dt_depth = 0;
+  numberDTree(entryBlock, 1, dtGap * cfgBlocks.size());
 
   validDominanceAcceleration = true;
 
@@ -639,102 +806,621 @@ void regionCFG::fastDominancePreComputation() {
 #endif
 }
 
-void regionCFG::computeLengauerTarjanDominance() {
-  LengauerTarjanDominators LTD(cfgBlocks);
-  LTD();
-  
+void regionCFG::computeDominance() {
+  std::vector<uint32_t> idom;
+  dominators::compute(domEngine, graph, entryBlock->id, idom);
+  for(uint32_t v = 0, n = cfgBlocks.size(); v < n; v++) {
+    cfgBasicBlock *cbb = cfgBlocks[v];
+    if(idom[v] == dominators::none) {
+      cbb->getIdom() = nullptr;
+      continue;
+    }
+    cbb->getIdom() = cfgBlocks[idom[v]];
+    cbb->getIdom()->addDTreeSucc(cbb);
+  }
 }
  
-void regionCFG::computeDominance() {
-  using namespace boost;
-  using namespace std;
-  bool changed = true;
-  vector<cfgBasicBlock*> preOrderVisit(cfgBlocks.size());
-  std::map<cfgBasicBlock*, size_t> blockToNumMap;
-  
-  map<cfgBasicBlock*, dynamic_bitset<>> domMap;
-  
-  size_t dfsNum = 0;
-
-  /* use DFS to compute DFS numbers */
-  function<void(cfgBasicBlock*)> dfs =[&](cfgBasicBlock* bb) {
-    preOrderVisit.at(dfsNum) = bb;
-    blockToNumMap[bb] = dfsNum;
-    dfsNum++;
-    domMap[bb] = dynamic_bitset<>(cfgBlocks.size());
-    domMap.at(bb).set();
-    for(auto nbb : bb->succs) {
-      auto it = blockToNumMap.find(nbb);
-      if(it == blockToNumMap.end()) {
-	dfs(nbb);
+bool regionCFG::inDTree(const cfgBasicBlock *bb) const {
+  return (bb == entryBlock) or (bb->idombb != nullptr);
+}
+
+void regionCFG::updateDominance(cfgBasicBlock *from, cfgBasicBlock *to) {
+  /* nothing moves when to's idom dominates from already, else the
+   * nearest common dominator of the edge's ends is further up */
+  if((to->idombb == nullptr) or to->idombb->fastDominates(from)) {
+    return;
+  }
+  cfgBasicBlock *nca = to->idombb->idombb;
+  while(not(nca->fastDominates(from))) {
+    nca = nca->idombb;
+  }
+  const uint32_t d_nca = nca->dt_depth;
+  /* depth based search (Georgiadis et al.) : w now has nca as its
+   * idom iff some path from to reaches it over blocks no shallower
+   * than w, and w sat deeper than a child of nca. roots are taken
+   * deepest first, a search passes through blocks deeper than its
+   * root and queues shallower ones as roots of their own */
+  const uint64_t visit = ++dtSearches;
+  std::priority_queue<std::pair<uint32_t, uint32_t>> roots;
+  std::vector<cfgBasicBlock*> affected, stack;
+  to->dt_visit = visit;
+  roots.emplace(to->dt_depth, to->id);
+  while(not(roots.empty())) {
+    cfgBasicBlock *root = cfgBlocks[roots.top().second];
+    const uint32_t d = roots.top().first;
+    roots.pop();
+    affected.push_back(root);
+    stack.push_back(root);
+    while(not(stack.empty())) {
+      cfgBasicBlock *u = stack.back();
+      stack.pop_back();
+      for(cfgBasicBlock *v : u->succs) {
+	if(v->dt_visit == visit) {
+	  continue;
+	}
+	if(v->dt_depth > d) {
+	  v->dt_visit = visit;
+	  stack.push_back(v);
+	}
+	else if(v->dt_depth > (d_nca + 1)) {
+	  v->dt_visit = visit;
+	  roots.emplace(v->dt_depth, v->id);
+	}
       }
     }
-  };
-  
-  /* initialize */
-  dfs(entryBlock);
+  }
+  for(cfgBasicBlock *w : affected) {
+    std::vector<cfgBasicBlock*> &ds = w->idombb->dtree_succs;
+    ds.erase(std::find(ds.begin(), ds.end(), w));
+    w->idombb = nca;
+    nca->dtree_succs.push_back(w);
+  }
+  /* the rest of the tree keeps its numbers */
+  placeDTrees(nca, affected.size());
+}
 
-  domMap.at(entryBlock).reset();
-  domMap.at(entryBlock)[0] = true;
+void regionCFG::insertEdge(cfgBasicBlock *from, cfgBasicBlock *to) {
+  if(std::find(from->succs.begin(), from->succs.end(), to) != from->succs.end()) {
+    return;
+  }
+  from->addSuccessor(to);
+  if(not(inDTree(from))) {
+    return;
+  }
+  if(inDTree(to)) {
+    updateDominance(from, to);
+    return;
+  }
+  /* blocks first reached over the new edge : dominance among them
+   * comes from the engine on the subgraph they span, then their
+   * edges into the old tree count as insertions */
+  std::vector<cfgBasicBlock*> fresh(1, to);
+  std::unordered_map<const cfgBasicBlock*, uint32_t> local;
+  local[to] = 0;
+  for(size_t i = 0; i < fresh.size(); i++) {
+    for(cfgBasicBlock *s : fresh[i]->succs) {
+      if(not(inDTree(s)) and local.emplace(s, fresh.size()).second) {
+	fresh.push_back(s);
+      }
+    }
+  }
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  std::vector<std::pair<cfgBasicBlock*, cfgBasicBlock*>> cross;
+  for(uint32_t i = 0; i < fresh.size(); i++) {
+    for(cfgBasicBlock *s : fresh[i]->succs) {
+      auto it = local.find(s);
+      if(it != local.end()) {
+	edges.emplace_back(i, it->second);
+      }
+      else {
+	cross.emplace_back(fresh[i], s);
+      }
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  cfg_graph g;
+  g.build(fresh.size(), edges);
+  std::vector<uint32_t> idom;
+  dominators::compute(domEngine, g, 0, idom);
+  to->idombb = from;
+  from->addDTreeSucc(to);
+  for(uint32_t i = 1; i < fresh.size(); i++) {
+    fresh[i]->idombb = fresh[idom[i]];
+    fresh[idom[i]]->addDTreeSucc(fresh[i]);
+  }
+  placeDTrees(from, 1);
+  for(const auto &e : cross) {
+    updateDominance(e.first, e.second);
+  }
+}
 
-  
-  /* compute dominators */
-  do {
-    changed = false;
-    for(size_t bId=0, n=preOrderVisit.size(); bId < n; bId++) {
-      cfgBasicBlock *cbb = preOrderVisit[bId];
-      dynamic_bitset<> tdd = domMap.at(cbb);
-      for(cfgBasicBlock *nbb : cbb->getPreds()) {
-	tdd &= domMap.at(nbb);
+cfgBasicBlock *regionCFG::splitBlock(cfgBasicBlock *cbb, basicBlock *tail) {
+  uint64_t ea = tail->getEntryAddr();
+  cfgBasicBlock *nbb = newBlock(nullptr);
+  nbb->bb = tail;
+  /* a followed block holds no instructions of its own */
+  if(not(cbb->rawInsns.empty())) {
+    auto it = std::find_if(cbb->rawInsns.begin(), cbb->rawInsns.end(),
+			   [ea](const basicBlock::instruction &i) {
+			     return i.pc == ea;
+			   });
+    assert((it != cbb->rawInsns.begin()) and (it != cbb->rawInsns.end()));
+    size_t k = it - cbb->rawInsns.begin();
+    nbb->rawInsns.assign(it, cbb->rawInsns.end());
+    cbb->rawInsns.erase(it, cbb->rawInsns.end());
+    if(not(cbb->insns.empty())) {
+      nbb->insns.assign(cbb->insns.begin() + k, cbb->insns.end());
+      cbb->insns.resize(k);
+      for(Insn *ins : nbb->insns) {
+	ins->set(this, nbb);
       }
-      tdd[bId] = true;
-      //check if changed
-      if(tdd != domMap.at(cbb)) {
-	changed = true;
-	domMap.at(cbb) = tdd;
+    }
+  }
+  std::vector<cfgBasicBlock*> succs = cbb->succs;
+  for(cfgBasicBlock *s : succs) {
+    cbb->delSuccessor(s);
+    nbb->addSuccessor(s);
+  }
+  cbb->addSuccessor(nbb);
+  if(cbb->bb and (cbb->bb->cfgCplr == this)) {
+    blocks.insert(tail);
+    tail->cfgCplr = this;
+  }
+  cfgBlockMap[ea] = nbb;
+  if(not(inDTree(cbb))) {
+    return nbb;
+  }
+  /* every path out of cbb now runs through nbb, which takes a spare
+   * number between cbb's and its first child's and the rest of cbb's
+   * range, the blocks below sinking a level */
+  nbb->dtree_succs.swap(cbb->dtree_succs);
+  ssize_t first = cbb->dt_max_ancestor_dfn + 1;
+  for(cfgBasicBlock *c : nbb->dtree_succs) {
+    c->idombb = nbb;
+    first = std::min(first, c->dt_dfn);
+  }
+  nbb->idombb = cbb;
+  cbb->addDTreeSucc(nbb);
+  if(nbb->dtree_succs.empty() and ((first - cbb->dt_dfn) < 2) and growDTree(cbb)) {
+    first = cbb->dt_max_ancestor_dfn + 1;
+  }
+  if((first - cbb->dt_dfn) < 2) {
+    renumberDTree(cbb);
+    return nbb;
+  }
+  nbb->dt_dfn = cbb->dt_dfn + (first - cbb->dt_dfn) / 2;
+  nbb->dt_max_ancestor_dfn = cbb->dt_max_ancestor_dfn;
+  nbb->dt_depth = cbb->dt_depth + 1;
+  std::vector<cfgBasicBlock*> stack(nbb->dtree_succs);
+  while(not(stack.empty())) {
+    cfgBasicBlock *bb = stack.back();
+    stack.pop_back();
+    bb->dt_depth++;
+    stack.insert(stack.end(), bb->dtree_succs.begin(), bb->dtree_succs.end());
+  }
+  return nbb;
+}
+
+/* the tree over the current edges is the one the engine finds, the
+ * depths follow it and the fastDominates numbers of every block nest
+ * inside its idom's without overlapping its siblings' */
+bool regionCFG::checkDominance() {
+  buildGraph();
+  std::vector<uint32_t> idom;
+  dominators::compute(domEngine, graph, entryBlock->id, idom);
+  size_t inTree = 0;
+  for(cfgBasicBlock *cbb : cfgBlocks) {
+    cfgBasicBlock *d = (idom[cbb->id] == dominators::none) ? nullptr : cfgBlocks[idom[cbb->id]];
+    if(cbb->idombb != d) {
+      return false;
+    }
+    if(not(inDTree(cbb))) {
+      continue;
+    }
+    if(cbb->dt_dfn > cbb->dt_max_ancestor_dfn) {
+      return false;
+    }
+    if(d and ((cbb->dt_depth != (d->dt_depth + 1)) or
+	      (cbb->dt_dfn <= d->dt_dfn) or
+	      (cbb->dt_max_ancestor_dfn > d->dt_max_ancestor_dfn))) {
+      return false;
+    }
+    std::vector<std::pair<ssize_t, ssize_t>> r;
+    for(cfgBasicBlock *c : cbb->dtree_succs) {
+      if(c->idombb != cbb) {
+	return false;
+      }
+      r.emplace_back(c->dt_dfn, c->dt_max_ancestor_dfn);
+    }
+    std::sort(r.begin(), r.end());
+    for(size_t i = 1; i < r.size(); i++) {
+      if(r[i].first <= r[i-1].second) {
+	return false;
       }
     }
+    inTree += r.size();
+    inTree += (d == nullptr);
   }
-  while(changed);
-  
-  for(size_t i = 1, n = preOrderVisit.size(); i < n; i++) {
-    cfgBasicBlock *cbb = preOrderVisit[i];
-    dynamic_bitset<> &dom = domMap.at(cbb);
-    dom[i] = false;
-    /* iterate over blocks that dominate current block */
-    for(size_t j = dom.find_first(); j != dynamic_bitset<>::npos; j = dom.find_next(j)) {
-      const dynamic_bitset<> &ddom = domMap.at(preOrderVisit.at(j));
-      for(size_t k = ddom.find_first(); k != dynamic_bitset<>::npos; k = ddom.find_next(k)) {
-	/* if j dominates k, k can not be the immediate dominator */
-	if(k!=j)
-	  dom[k]=false;
+  for(cfgBasicBlock *cbb : cfgBlocks) {
+    inTree -= inDTree(cbb);
+  }
+  return inTree == 0;
+}
+
+bool regionCFG::benchIncremental(size_t runs) {
+  static const uint32_t nop = 0x13, insns = 8;
+  const size_t updates = 20 * runs;
+  std::mt19937_64 rng(1);
+  pc_profile prof;
+  pipeline_store pt;
+  bool ok = true;
+  for(size_t n = 100; n <= 100000; n *= 10) {
+    regionCFG c("dom-bench", prof, pt);
+    std::vector<cfgBasicBlock*> bl;
+    std::vector<basicBlock*> tails;
+    /* blocks of nops far from any trace, the first half reachable
+     * from block 0 and the rest only among themselves so insertions
+     * also reach fresh blocks */
+    const uint64_t base = 1UL << 60;
+    for(size_t i = 0; i < n; i++) {
+      cfgBasicBlock *cbb = c.newBlock(nullptr);
+      for(uint32_t k = 0; k < insns; k++) {
+	uint64_t pc = base + (i * insns + k) * 4;
+	cbb->rawInsns.emplace_back(nop, pc, pc, 0);
       }
+      bl.push_back(cbb);
+    }
+    const size_t half = n / 2;
+    for(size_t i = 0; (i + 1) < n; i++) {
+      if((i + 1) != half) {
+	bl[i]->addSuccessor(bl[i+1]);
+      }
+      size_t lo = (i < half) ? 0 : half, hi = (i < half) ? half : n;
+      if((rng() % 4) == 0) {
+	bl[i]->addSuccessor(bl[lo + rng() % (hi - lo)]);
+      }
+    }
+    c.entryBlock = bl[0];
+    c.buildGraph();
+    c.computeDominance();
+    c.fastDominancePreComputation();
+
+    size_t inserts = 0, splits = 0, bad = 0;
+    double t_inc = 0.0;
+    std::vector<double> ts;
+    for(size_t u = 0; u < updates; u++) {
+      if((rng() % 4) == 0) {
+	cfgBasicBlock *cbb = bl[rng() % bl.size()];
+	if(cbb->rawInsns.size() < 2) {
+	  continue;
+	}
+	size_t at = 1 + rng() % (cbb->rawInsns.size() - 1);
+	basicBlock *tail = new basicBlock(cbb->rawInsns[at].pc);
+	tail->vecIns.assign(cbb->rawInsns.begin() + at, cbb->rawInsns.end());
+	tails.push_back(tail);
+	double t = timestamp();
+	bl.push_back(c.splitBlock(cbb, tail));
+	ts.push_back(timestamp() - t);
+	t_inc += ts.back();
+	splits++;
+      }
+      else {
+	cfgBasicBlock *a = bl[rng() % bl.size()], *b = bl[rng() % bl.size()];
+	double t = timestamp();
+	c.insertEdge(a, b);
+	ts.push_back(timestamp() - t);
+	t_inc += ts.back();
+	inserts++;
+      }
+      bad += not(c.checkDominance());
+    }
+
+    /* the same tree from scratch */
+    std::vector<cfgBasicBlock*> idoms;
+    for(cfgBasicBlock *cbb : c.cfgBlocks) {
+      idoms.push_back(cbb->idombb);
+      cbb->idombb = nullptr;
+      cbb->dtree_succs.clear();
+    }
+    double t = timestamp();
+    c.computeDominance();
+    c.fastDominancePreComputation();
+    double t_full = timestamp() - t;
+    for(cfgBasicBlock *cbb : c.cfgBlocks) {
+      bad += (cbb->idombb != idoms[cbb->id]);
+    }
+
+    std::sort(ts.begin(), ts.end());
+    std::cout << n << " blocks, " << inserts << " insertions, " << splits << " splits :"
+	      << " incremental " << (t_inc * 1e3 / std::max<size_t>(1, inserts + splits)) << " ms per update"
+	      << " (median " << (ts.empty() ? 0.0 : ts[ts.size() / 2] * 1e3) << " ms),"
+	      << " full recompute " << (t_full * 1e3) << " ms";
+    if(bad) {
+      std::cout << " (" << bad << " disagree with a full recompute)";
+      ok = false;
+    }
+    std::cout << "\n";
+    /* the tails are only the region's, not the trace's */
+    for(basicBlock *tail : tails) {
+      basicBlock::bbMap.erase(tail->getEntryAddr());
+      delete tail;
     }
-    cbb->getIdom() = preOrderVisit.at(dom.find_first());
-    cbb->getIdom()->addDTreeSucc(cbb);
   }
-  entryBlock->getIdom() = nullptr;
+  return ok;
 }
- 
+
+void regionCFG::followChanges() {
+  auto find = [this](const basicBlock *bb) {
+    return cfgBlockMap.at(bb->getEntryAddr());
+  };
+  for(const basicBlock::change &c : basicBlock::changes) {
+    switch(c.k)
+      {
+      case basicBlock::change::kind::block: {
+	if(entryBlock == nullptr) {
+	  entryBlock = newBlock(nullptr);
+	  entryBlock->dt_depth = 0;
+	  numberDTree(entryBlock, 1, dtGap);
+	  validDominanceAcceleration = true;
+	}
+	cfgBasicBlock *cbb = newBlock(nullptr);
+	cbb->bb = c.a;
+	cfgBlockMap[c.a->getEntryAddr()] = cbb;
+	if(cfgHead == nullptr) {
+	  head = c.a;
+	  cfgHead = cbb;
+	  insertEdge(entryBlock, cbb);
+	}
+	break;
+      }
+      case basicBlock::change::kind::split:
+	splitBlock(find(c.a), c.b);
+	break;
+      case basicBlock::change::kind::edge:
+	insertEdge(find(c.a), find(c.b));
+	break;
+      }
+  }
+  basicBlock::changes.clear();
+}
+
+void regionCFG::writeLiveLoops(const std::string &filename) const {
+  struct liveLoop {
+    uint64_t vpc = 0, taken = 0, entries = 0;
+    std::vector<uint64_t> latches;
+  };
+  /* u -> h is a back edge when h dominates u */
+  std::map<uint32_t, liveLoop> byHeader;
+  for(const cfgBasicBlock *u : cfgBlocks) {
+    if((u->bb == nullptr) or u->bb->empty() or not(inDTree(u))) {
+      continue;
+    }
+    const uint64_t t = u->bb->getVecIns().back().pc;
+    for(const cfgBasicBlock *h : u->succs) {
+      if((h->bb == nullptr) or h->bb->empty() or not(h->fastDominates(u))) {
+	continue;
+      }
+      liveLoop &l = byHeader[h->id];
+      const basicBlock::instruction &e = h->bb->getVecIns().front();
+      l.vpc = e.vpc;
+      l.entries = prof.count_at(e.prof);
+      l.taken += basicBlock::globalEdges.get(t, e.pc);
+      l.latches.push_back(u->bb->getVecIns().front().vpc);
+    }
+  }
+  std::vector<liveLoop> sorted;
+  for(auto &p : byHeader) {
+    std::sort(p.second.latches.begin(), p.second.latches.end());
+    sorted.push_back(p.second);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+		   [](const liveLoop &a, const liveLoop &b) {
+		     return a.taken > b.taken;
+		   });
+  std::ofstream out(filename);
+  for(const liveLoop &l : sorted) {
+    out << "loop " << std::hex << l.vpc << std::dec
+	<< ", back edges taken " << l.taken
+	<< " of " << l.entries << " entries, latches" << std::hex;
+    for(uint64_t v : l.latches) {
+      out << " " << v;
+    }
+    out << std::dec << "\n";
+  }
+}
+
 void regionCFG::computeDominanceFrontiers() {
   /* compute dominance frontiers */
   for(auto cbb : cfgBlocks) {
     /* only blocks with more than one pred
      * can update dominance frontiers */
-    if(cbb->preds.size() > 1) {
-      for(auto nbb : cbb->getPreds()) {
+    cfg_graph::range preds = graph.preds(cbb->id);
+    if(preds.size() > 1) {
+      for(uint32_t p : preds) {
+	cfgBasicBlock *nbb = cfgBlocks[p];
 	/* iterate back to idom 
 	 * adding this node to 
-	 * appropriate dominance frontiers */
+	 * appropriate dominance frontiers,
+	 * a runner meets cbb again only while cbb is
+	 * the last block it took on */
 	while((nbb != cbb->getIdom())) {
-	    nbb->dfrontier.insert(cbb);
-	    nbb = nbb->getIdom();
+	  if(nbb->dfrontier.empty() or (nbb->dfrontier.back() != cbb)) {
+	    nbb->dfrontier.push_back(cbb);
 	  }
+	  nbb = nbb->getIdom();
+	}
       }
     }
   }
 }
 
+bool regionCFG::exitsRegion(const cfgBasicBlock *cbb) const {
+  if(cbb->bb == nullptr) {
+    return false;
+  }
+  if(cbb->succs.empty()) {
+    return true;
+  }
+  /* a call comes back to the block after it */
+  uint32_t inst = cbb->rawInsns.back().inst;
+  if(is_jal(inst) or is_jalr(inst)) {
+    return false;
+  }
+  for(const basicBlock *nbb : cbb->bb->getSuccs()) {
+    if(cfgBlockMap.find(nbb->getEntryAddr()) == cfgBlockMap.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void regionCFG::computePostDominance() {
+  const uint32_t n = cfgBlocks.size(), exit = n;
+  /* blocks leaving the region reach the virtual exit */
+  std::vector<uint32_t> sources;
+  std::vector<bool> reached(n, false);
+  std::vector<uint32_t> stack;
+  auto reach = [&](uint32_t v) {
+    sources.push_back(v);
+    reached[v] = true;
+    stack.push_back(v);
+    while(not(stack.empty())) {
+      uint32_t u = stack.back();
+      stack.pop_back();
+      for(uint32_t p : graph.preds(u)) {
+	if(not(reached[p])) {
+	  reached[p] = true;
+	  stack.push_back(p);
+	}
+      }
+    }
+  };
+  for(uint32_t v = 0; v < n; v++) {
+    if(exitsRegion(cfgBlocks[v]) and not(reached[v])) {
+      reach(v);
+    }
+  }
+  /* blocks that never get out (an endless loop, a whole program
+   * trace) exit from the first of them to finish in a dfs from
+   * the entry, the bottom of the loop */
+  std::vector<std::pair<uint32_t, const uint32_t*>> dfs;
+  std::vector<bool> seen(n, false);
+  seen[entryBlock->id] = true;
+  dfs.emplace_back(entryBlock->id, graph.succs(entryBlock->id).begin());
+  while(not(dfs.empty())) {
+    uint32_t v = dfs.back().first;
+    if(dfs.back().second == graph.succs(v).end()) {
+      dfs.pop_back();
+      if(not(reached[v])) {
+	reach(v);
+      }
+      continue;
+    }
+    uint32_t w = *(dfs.back().second++);
+    if(not(seen[w])) {
+      seen[w] = true;
+      dfs.emplace_back(w, graph.succs(w).begin());
+    }
+  }
+
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  for(uint32_t v : sources) {
+    edges.emplace_back(exit, v);
+  }
+  for(uint32_t u = 0; u < n; u++) {
+    for(uint32_t v : graph.succs(u)) {
+      edges.emplace_back(v, u);
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  cfg_graph rgraph;
+  rgraph.build(n + 1, edges);
+  std::vector<uint32_t> ipdom;
+  dominators::compute(domEngine, rgraph, exit, ipdom);
+  for(uint32_t v = 0; v < n; v++) {
+    cfgBasicBlock *cbb = cfgBlocks[v];
+    cbb->ipdombb = ((ipdom[v] == dominators::none) or (ipdom[v] == exit)) ? nullptr : cfgBlocks[ipdom[v]];
+  }
+}
+
+void regionCFG::computeControlDependence() {
+  /* Ferrante et al. : over an edge a -> b that b doesn't post-dominate
+   * a, b and its post-dominators up to (not including) a's immediate
+   * post-dominator are control dependent on a */
+  for(cfgBasicBlock *a : cfgBlocks) {
+    for(uint32_t s : graph.succs(a->id)) {
+      for(cfgBasicBlock *r = cfgBlocks[s]; r and (r != a->ipdombb); r = r->ipdombb) {
+	if(r->cdg_preds.empty() or (r->cdg_preds.back() != a)) {
+	  r->cdg_preds.push_back(a);
+	  a->cdg_succs.push_back(r);
+	}
+      }
+    }
+  }
+}
+
+void regionCFG::writeBranchReport() const {
+  const std::string filename = name + "_branches_" + toStringHex(head->getEntryAddr()) + ".txt";
+  std::ofstream out(filename);
+  std::vector<double> cycles(cfgBlocks.size(), 0.0);
+  double total = 0.0;
+  for(const cfgBasicBlock *cbb : cfgBlocks) {
+    for(const auto &i : cbb->rawInsns) {
+      cycles[cbb->id] += prof.cycles_at(i.prof);
+    }
+    total += cycles[cbb->id];
+  }
+  struct branch {
+    const cfgBasicBlock *cbb;
+    double cycles;
+  };
+  std::vector<branch> branches;
+  for(const cfgBasicBlock *cbb : cfgBlocks) {
+    if(cbb->rawInsns.empty() or not(is_branch(cbb->rawInsns.back().inst)) or
+       cbb->cdg_succs.empty()) {
+      continue;
+    }
+    double c = 0.0;
+    for(const cfgBasicBlock *d : cbb->cdg_succs) {
+      c += cycles[d->id];
+    }
+    branches.push_back(branch{cbb, c});
+  }
+  std::sort(branches.begin(), branches.end(), [](const branch &a, const branch &b) {
+      if(a.cycles != b.cycles) {
+	return a.cycles > b.cycles;
+      }
+      return a.cbb->getEntryAddr() < b.cbb->getEntryAddr();
+    });
+  if(total == 0.0) {
+    total = 1.0;
+  }
+  out << std::fixed << std::setprecision(2);
+  for(const branch &b : branches) {
+    const cfgBasicBlock *cbb = b.cbb;
+    uint64_t t = cbb->rawInsns.back().pc;
+    out << "branch " << std::hex << cbb->rawInsns.back().vpc << std::dec
+	<< ", count " << prof.count_at(cbb->rawInsns.back().prof)
+	<< ", controls " << cbb->cdg_succs.size() << " blocks"
+	<< ", cycles " << b.cycles
+	<< " (" << (100.0 * b.cycles / total) << "%)\n";
+    for(const cfgBasicBlock *nbb : cbb->succs) {
+      uint64_t e = nbb->getEntryAddr();
+      /* the blocks this edge controls */
+      double c = 0.0;
+      size_t nc = 0;
+      for(const cfgBasicBlock *r = nbb; r and (r != cbb->ipdombb); r = r->ipdombb) {
+	c += cycles[r->id];
+	nc++;
+      }
+      out << "\t-> " << std::hex << nbb->getEntryVirtualAddr() << std::dec
+	  << ", edge count " << basicBlock::globalEdges.get(t, e)
+	  << ", controls " << nc << " blocks"
+	  << ", cycles " << c << "\n";
+    }
+  }
+}
+
 bool regionCFG::dominates(cfgBasicBlock *A, cfgBasicBlock *B) const {
   if(validDominanceAcceleration) {
     return A->fastDominates(B);
@@ -774,34 +1460,33 @@ void gprPhiNode::addIncomingEdge(regionCFG *cfg, cfgBasicBlock *b) {
   
   ssaInsn *in = b->ssaRegTbl.gprTbl[gprId];
   assert(in);  
-  addUse(in);
+  in->addUse(this);
 
   //std::cout << "dstReg = " << in->destRegister() << "\n";
   
   inBoundEdges.emplace_back(b, in);
 }
 
-double regionCFG::getTipCycles(uint64_t ip) const {
-  auto it = tip.find(ip);
-  if(it != tip.end()) {
-    return it->second;
-  }
-  //std::cout << "couldnt find tip info for ip " << std::hex << ip << std::dec << "\n";
-  return 0.0;
-}
 
+/* hottest first, ties broken by entry address rather than by
+ * where the blocks happen to be allocated */
+static void sortHot(std::vector<std::pair<double, const basicBlock*>> &hotblocks) {
+  std::sort(hotblocks.begin(), hotblocks.end(),
+	    [](const std::pair<double, const basicBlock*> &a,
+	       const std::pair<double, const basicBlock*> &b) {
+	      if(a.first != b.first) {
+		return a.first > b.first;
+	      }
+	      return a.second->getEntryAddr() < b.second->getEntryAddr();
+	    });
+}
 
-void regionCFG::asText() const {
-  const std::string filename = name + "_cfg_" + toStringHex(head->getEntryAddr()) + ".txt"; 
+void writeHotBlocks(const std::string &filename,
+		    const std::set<const basicBlock*> &bbs,
+		    const pc_profile &prof,
+		    bool warn_missing,
+		    std::ostream &log) {
   std::ofstream out(filename);
-  std::set<const basicBlock*> bbs;
-  
-  for(const cfgBasicBlock* cbb : cfgBlocks) {
-    const basicBlock *bb = cbb->bb;
-    if(bb) {
-      bbs.insert(bb);
-    }
-  }
   double total_cycles = 0.0;
   std::vector<std::pair<double,  const basicBlock*>> hotblocks;
   for(const auto bb : bbs) {
@@ -809,30 +1494,30 @@ void regionCFG::asText() const {
     double t = 0.0;
     for(ssize_t i = 0, ni = insns.size(); i < ni; i++) {
       const auto &p = insns.at(i);
-      t+= tip[p.pc];
-      total_cycles += tip[p.pc];
+      t+= prof.cycles_at(p.prof);
+      total_cycles += prof.cycles_at(p.prof);
     }
     hotblocks.emplace_back(t, bb);
   }
-  std::sort(hotblocks.begin(), hotblocks.end());
-  std::reverse(hotblocks.begin(), hotblocks.end());
+  sortHot(hotblocks);
 
   for(size_t i = 0, l = hotblocks.size(); i < l; i++) {
     auto bb = hotblocks.at(i).second;
     uint64_t ea = bb->getEntryAddr();
     const auto & insns = bb->getVecIns();    
     size_t num = insns.size();
-    double ipc = (num*counts[ea]) / hotblocks.at(i).first;    
+    uint64_t count = prof.count_at(insns.front().prof);
+    double ipc = (num*count) / hotblocks.at(i).first;    
     
     double cycles = 0.0, percent;
     for(ssize_t i = 0, ni = insns.size(); i < ni; i++) {
       const auto &p = insns.at(i);
-      cycles += tip[p.pc];
+      cycles += prof.cycles_at(p.prof);
     }
     percent = (cycles/total_cycles)*100.0;
     
     out << "bb" << std::hex << ea << std::dec
-	<< ", count " << counts[ea]
+	<< ", count " << count
 	<< ", cycles " << cycles
 	<< std::fixed << std::setprecision(2)
 	<< ", ipc " << ipc
@@ -845,13 +1530,13 @@ void regionCFG::asText() const {
       uint32_t inst = p.inst;
       uint64_t addr = p.pc;
       
-      if(tip.find(addr) == tip.end()) {
-	std::cout << "cant find phys addr "<< std::hex << addr
-		  << " virt addr " << p.vpc
-		  << std::dec
-		  << " in the tip map\n";
+      if(warn_missing and not(prof.has_tip_at(p.prof))) {
+	log << "cant find phys addr "<< std::hex << addr
+	    << " virt addr " << p.vpc
+	    << std::dec
+	    << " in the tip map\n";
       }
-      double cycles = static_cast<double>(tip[addr]) / counts[addr];
+      double cycles = prof.cpi_at(p.prof);
       auto asmString = getAsmString(inst, addr);
       out << std::hex << p.vpc << std::dec
 	  << " : " << asmString
@@ -867,6 +1552,20 @@ void regionCFG::asText() const {
 }
 
 
+void regionCFG::asText() const {
+  const std::string filename = name + "_cfg_" + toStringHex(head->getEntryAddr()) + ".txt"; 
+  std::set<const basicBlock*> bbs;
+  
+  for(const cfgBasicBlock* cbb : cfgBlocks) {
+    const basicBlock *bb = cbb->bb;
+    if(bb) {
+      bbs.insert(bb);
+    }
+  }
+  writeHotBlocks(filename, bbs, prof, true, *log);
+}
+
+
 void regionCFG::asDot() const {
   const std::string filename = name + "_cfg_" + toStringHex(head->getEntryAddr()) + ".dot"; 
   std::ofstream out(filename);
@@ -885,44 +1584,34 @@ void regionCFG::asDot() const {
     double t = 0.0;
     for(ssize_t i = 0, ni = insns.size(); i < ni; i++) {
       const auto &p = insns.at(i);
-      t+= tip[p.pc];
+      t+= prof.cycles_at(p.prof);
     }
     hotblocks.emplace_back(t, bb);
   }
-  std::sort(hotblocks.begin(), hotblocks.end());
-  std::reverse(hotblocks.begin(), hotblocks.end());
+  sortHot(hotblocks);
 
 
-  std::cout << "hottest blocks\n";
+  *log << "hottest blocks\n";
   bool gotpt = not(pt.empty());
   for(size_t i = 0, l = hotblocks.size(); i < std::min(10UL, l); i++) {
     auto bb = hotblocks.at(i).second;
-    uint64_t ea = bb->getEntryAddr();
     const auto &vecIns = bb->getVecIns();
     uint64_t vpc = vecIns.at(0).vpc;
-    size_t num = bb->getVecIns().size();
-    double ipc = (num*counts[ea]) / hotblocks.at(i).first;
-    std::cout << std::hex << vpc << std::dec << ","
-	      << hotblocks.at(i).first << ","
-	      << ipc << "\n";
+    size_t num = vecIns.size();
+    double ipc = (num*prof.count_at(vecIns.front().prof)) / hotblocks.at(i).first;
+    *log << std::hex << vpc << std::dec << ","
+	 << hotblocks.at(i).first << ","
+	 << ipc << "\n";
     if(gotpt) {
-      uint64_t icnt = 0;
-      std::vector<uint64_t> instances;
-      
-      for(const pipeline_record & r : pt) {
-	if(r.pc == vpc) {
-	  instances.push_back(icnt);
-	}
-	icnt++;
-      }
-      std::cout << "\t" << instances.size() << " instances\n";
+      pipeline_store::ordinal_range instances = pt.instances(vpc);
+      *log << "\t" << instances.size() << " instances\n";
       if(instances.size() < 10) {
 	continue;
       }
       uint64_t m = instances.size() / 2;
-      uint64_t start = instances.at(m-1)-4;
-      uint64_t stop = instances.at(m-1)+128;
-      std::cout << "will dump " << (stop-start) << " instructions\n";
+      uint64_t start = instances.b[m-1]-4;
+      uint64_t stop = instances.b[m-1]+128;
+      *log << "will dump " << (stop-start) << " instructions\n";
       std::stringstream nss;
       nss << name << "_pipe_" << std::hex << vpc << std::dec << ".html";
       dump_pipe(nss.str(), pt, start, stop);
@@ -933,21 +1622,22 @@ void regionCFG::asDot() const {
   /* vertices */
   for(size_t hb = 0; hb < hotblocks.size(); hb++) {
     auto bb = hotblocks.at(hb).second;
-    size_t num = bb->getVecIns().size();
+    const auto & insns = bb->getVecIns();
+    size_t num = insns.size();
     uint64_t ea = bb->getEntryAddr();    
-    double ipc = (num*counts[ea]) / hotblocks.at(hb).first;
+    uint64_t count = prof.count_at(insns.front().prof);
+    double ipc = (num*count) / hotblocks.at(hb).first;
     
-    const auto & insns = bb->getVecIns();
     double cycles = 0.0;
     for(ssize_t i = 0, ni = insns.size(); i < ni; i++) {
       const auto &p = insns.at(i);
-      cycles += tip[p.pc];
+      cycles += prof.cycles_at(p.prof);
     }
     
 
     out << "\"bb" << std::hex << ea << std::dec << "\"[\n";
     out << "label = <bb_0x" << std::hex << ea << std::dec
-	<< ", count " << counts[ea]
+	<< ", count " << count
 	<< ", cycles " << cycles
 	<< std::fixed << std::setprecision(2)
 	<< ", ipc " << ipc
@@ -958,13 +1648,13 @@ void regionCFG::asDot() const {
       uint32_t inst = p.inst;
       uint64_t addr = p.pc;
       
-      if(tip.find(addr) == tip.end()) {
-	std::cout << "cant find phys addr "<< std::hex << addr
-		  << " virt addr " << p.vpc
-		  << std::dec
-		  << " in the tip map\n";
+      if(not(prof.has_tip_at(p.prof))) {
+	*log << "cant find phys addr "<< std::hex << addr
+	     << " virt addr " << p.vpc
+	     << std::dec
+	     << " in the tip map\n";
       }
-      double cycles = static_cast<double>(tip[addr]) / counts[addr];
+      double cycles = prof.cpi_at(p.prof);
       auto asmString = getAsmString(inst, addr);
       out << std::hex << p.vpc << std::dec
 	  << " : " << asmString
@@ -981,7 +1671,7 @@ void regionCFG::asDot() const {
     std::string s = ss.str();
     for(const auto &nbb : bb->getSuccs()) {
       uint64_t e = nbb->getEntryAddr();
-      uint64_t w = basicBlock::globalEdges[t][e];
+      uint64_t w = basicBlock::globalEdges.get(t, e);
       out << s
 	  << " -> "
 	  << "\"bb"
@@ -1070,116 +1760,215 @@ void regionCFG::dumpIR() {
 }
  
 
-void regionCFG::findLoop(std::set<cfgBasicBlock*> &loop, 
-			std::list<cfgBasicBlock*> &stack,
-			cfgBasicBlock *hbb) {
-  while(!stack.empty()) {
-    cfgBasicBlock *c = stack.front();
-    stack.pop_front();
-    loop.insert(c);
-    if(c != hbb) {
-      for(std::set<cfgBasicBlock*>::iterator sit = c->preds.begin(); sit != c->preds.end(); sit++) {
-	cfgBasicBlock *cc = *sit;
-	if(loop.find(cc) == loop.end()) {	
-	  stack.push_front(cc);
-	}
-      }
-    }
-  }
-}
-
 void regionCFG::printNaturalLoops(int d) const {
   for(size_t l_id = 0, n_loops = loops.size(); l_id < n_loops; l_id++) {
     const auto *l = loops.at(l_id);
     std::cout << "subgraph cluster_" << l_id << "\n";
-    for(const auto *bb : l->getLoop()) {
+    for(const auto *bb : l->getBlocks()) {
       std::cout << std::hex <<  bb->getEntryVirtualAddr() <<std::dec << "\n";
     }
   }
 }
 
-
+/* Havlak, Nesting of reducible and irreducible loops (TOPLAS 97) :
+ * headers are visited in reverse dfs pre-order, each collapses the
+ * blocks (and inner loops, by union-find) that reach its back edges
+ * without leaving its dfs subtree. a path in from outside the
+ * subtree makes the loop irreducible and is handed on to the header
+ * so the enclosing loops see it */
 void regionCFG::findNaturalLoops() {
   assert(loops.size() == 0);
-  for(cfgBasicBlock *lbb : cfgBlocks) {
-    for(cfgBasicBlock *hbb : lbb->succs) {
-      if(dominates(hbb, lbb)) {
-	//std::cout << "loop backedge in bb " << lbb->getName() << " head in " << hbb->getName() << "\n";
-	std::set<cfgBasicBlock*> loop;
-	std::list<cfgBasicBlock*> stack;
-	stack.push_front(lbb);
-	/* BFS on preds to find natural loops */
-	findLoop(loop, stack, hbb);
-	bool badInsn = false;
-	for(auto bb : loop) {
-	  if(bb->has_jal_jr_jalr()) {
-	    badInsn = true;
-	    break;
-	  }
+  const uint32_t none = dominators::none;
+  const uint32_t n = cfgBlocks.size();
+  /* dfs pre-order from the entry, last[i] is the last number in the
+   * subtree of number i */
+  std::vector<uint32_t> order, num(n, none), last;
+  std::vector<std::pair<uint32_t, const uint32_t*>> stack;
+  num[entryBlock->id] = 0;
+  order.push_back(entryBlock->id);
+  last.push_back(0);
+  stack.emplace_back(entryBlock->id, graph.succs(entryBlock->id).begin());
+  while(not(stack.empty())) {
+    uint32_t v = stack.back().first;
+    if(stack.back().second == graph.succs(v).end()) {
+      last[num[v]] = order.size() - 1;
+      stack.pop_back();
+      continue;
+    }
+    uint32_t w = *(stack.back().second++);
+    if(num[w] == none) {
+      num[w] = order.size();
+      order.push_back(w);
+      last.push_back(0);
+      stack.emplace_back(w, graph.succs(w).begin());
+    }
+  }
+  const uint32_t m = order.size();
+  auto isAncestor = [&last](uint32_t w, uint32_t v) {
+    return (w <= v) and (v <= last[w]);
+  };
+  /* all by dfs number */
+  std::vector<std::vector<uint32_t>> backPreds(m), nonBackPreds(m);
+  for(uint32_t w = 0; w < m; w++) {
+    for(uint32_t p : graph.preds(order[w])) {
+      uint32_t v = num[p];
+      if(v == none) {
+	continue;
+      }
+      if(isAncestor(w, v)) {
+	backPreds[w].push_back(v);
+      }
+      else {
+	nonBackPreds[w].push_back(v);
+      }
+    }
+  }
+  /* outside[w] : the numbers entering w's loop other than through w,
+   * not yet inside an enclosing loop. kept ordered so the ones a header
+   * takes in come out as a range, merged smaller into larger as they
+   * move out (Havlak appends them to the header's preds instead, which
+   * goes quadratic on deeply nested irreducible loops) */
+  std::vector<std::set<uint32_t>> outside(m);
+  std::vector<uint32_t> rep(m), inPool(m, none), pool, work, path;
+  std::iota(rep.begin(), rep.end(), 0);
+  auto find = [&rep, &path](uint32_t v) {
+    path.clear();
+    while(rep[v] != v) {
+      path.push_back(v);
+      v = rep[v];
+    }
+    for(uint32_t x : path) {
+      rep[x] = v;
+    }
+    return v;
+  };
+  std::vector<naturalLoop*> loopAt(m, nullptr);
+  for(uint32_t w = m; w-- > 0; ) {
+    uint32_t latch = none;
+    bool irreducible = false;
+    pool.clear();
+    for(uint32_t v : backPreds[w]) {
+      if(latch == none) {
+	latch = v;
+      }
+      if(v == w) {
+	continue;
+      }
+      uint32_t x = find(v);
+      if(inPool[x] != w) {
+	inPool[x] = w;
+	pool.push_back(x);
+      }
+    }
+    auto take = [&](uint32_t y) {
+      y = find(y);
+      if((y != w) and (inPool[y] != w)) {
+	inPool[y] = w;
+	pool.push_back(y);
+	work.push_back(y);
+      }
+    };
+    work = pool;
+    while(not(work.empty())) {
+      uint32_t x = work.back();
+      work.pop_back();
+      for(uint32_t y : nonBackPreds[x]) {
+	if(isAncestor(w, y)) {
+	  take(y);
 	}
-	
-	if(badInsn or (loop.size() > 63)) {
-	  continue;
+	else {
+	  outside[w].insert(y);
 	}
-	
-	naturalLoop *l = new naturalLoop(hbb,lbb,loop);
-	loops.push_back(l);
       }
+      std::set<uint32_t> &o = outside[x];
+      if(o.empty()) {
+	continue;
+      }
+      auto lo = o.lower_bound(w), hi = o.upper_bound(last[w]);
+      std::vector<uint32_t> inside(lo, hi);
+      o.erase(lo, hi);
+      if(o.size() > outside[w].size()) {
+	o.swap(outside[w]);
+      }
+      outside[w].insert(o.begin(), o.end());
+      std::set<uint32_t>().swap(o);
+      for(uint32_t y : inside) {
+	take(y);
+      }
+    }
+    irreducible = not(outside[w].empty());
+    if(latch == none) {
+      continue;
     }
+    naturalLoop *l = new naturalLoop(cfgBlocks[order[w]], cfgBlocks[order[latch]], irreducible);
+    loopAt[w] = l;
+    l->addBlock(cfgBlocks[order[w]]);
+    std::sort(pool.begin(), pool.end());
+    for(uint32_t x : pool) {
+      rep[x] = w;
+      if(loopAt[x]) {
+	l->addChild(loopAt[x]);
+      }
+      else {
+	l->addBlock(cfgBlocks[order[x]]);
+      }
+    }
+    loops.push_back(l);
   }
 
   if(loops.empty())
     return;
-  
 
-  nestedLoops = loops;
-  
-  //use idom?
-
-  bool changed = true;
-
-  std::cout << "found " << nestedLoops.size() << " loops\n";  
-  
-  while(changed) {
-    std::sort(nestedLoops.begin(), nestedLoops.end(), sortNaturalLoops());  
-    std::reverse(nestedLoops.begin(), nestedLoops.end());
-    changed = false;
-    for(ssize_t i = 0, nl = nestedLoops.size(); i < nl; i++) {
-      naturalLoop *a = nestedLoops.at(i);
-      for(ssize_t j = i+1; j < nl; j++) {
-	naturalLoop *b = nestedLoops.at(j);
-	assert(not(a->isSameLoop(*b)));
-	assert(a->size() <= b->size());
-	if(b->isNestedLoop(*a)) {
-#if 1
-	  printf("found nesting a size %lu, b size %lu, a head pc %lx, b head pc %lx, a immed dom %lx\n",
-		 a->size(),
-		 b->size(),
-		 a->headVPC(),
-		 b->headVPC(),
-		 a->getHead()->getIdom()->getEntryAddr()
-		 );
-#endif
-	  b->addChild(a);
-	  nestedLoops.erase(nestedLoops.begin() + i);
-	  changed = true;
-	  break;
-	}
-      }
-      if(changed) {
-	break;
-      }
+  /* outer loops first */
+  std::reverse(loops.begin(), loops.end());
+  for(naturalLoop *l : loops) {
+    if(l->getParent() == nullptr) {
+      nestedLoops.push_back(l);
+    }
+    else {
+      l->setDepth(l->getParent()->getDepth() + 1);
     }
   }
-  
-  std::cout << "found " << nestedLoops.size() << " loops\n";
-  for(auto l : nestedLoops) {
-    printf("loop with latch %lx, %g cycles\n",
-	   l->getLatch()->getEntryAddr(),
-	   l->computeTipCycles());
+
+  /* headers come in dfs pre-order, so each loop follows the one
+   * it is nested in */
+  *log << "found " << loops.size() << " loops\n";
+  for(const naturalLoop *l : loops) {
+    *log << std::string(2*l->getDepth(), ' ')
+	 << "loop with latch " << std::hex << l->getLatch()->getEntryAddr()
+	 << std::dec << ", " << l->computeTipCycles() << " cycles\n";
+  }
+}
+
+void regionCFG::writeLoopReport() const {
+  const std::string filename = name + "_loops_" + toStringHex(head->getEntryAddr()) + ".txt";
+  std::ofstream out(filename);
+  double total = 0.0;
+  for(const cfgBasicBlock *cbb : cfgBlocks) {
+    total += cbb->computeTipCycles();
+  }
+  if(total == 0.0) {
+    total = 1.0;
+  }
+  out << std::fixed << std::setprecision(2);
+  /* the forest in pre-order, inner loops indented under theirs */
+  std::vector<const naturalLoop*> stack(nestedLoops.rbegin(), nestedLoops.rend());
+  while(not(stack.empty())) {
+    const naturalLoop *l = stack.back();
+    stack.pop_back();
+    out << std::string(l->getDepth(), '\t')
+	<< "loop " << std::hex << l->headVPC()
+	<< ", latch " << l->getLatch()->getEntryVirtualAddr() << std::dec
+	<< (l->isIrreducible() ? ", irreducible" : "")
+	<< ", depth " << l->getDepth()
+	<< ", " << l->size() << " blocks (" << l->getBlocks().size() << " own)"
+	<< ", cycles " << l->computeTipCycles()
+	<< " (" << (100.0 * l->computeTipCycles() / total) << "%)"
+	<< ", self cycles " << l->selfTipCycles()
+	<< " (" << (100.0 * l->selfTipCycles() / total) << "%)\n";
+    const auto &c = l->getChildren();
+    stack.insert(stack.end(), c.rbegin(), c.rend());
   }
-  
-  
 }
  
 uint64_t regionCFG::getEntryAddr() const {
@@ -1224,14 +2013,14 @@ uint64_t regionCFG::numBBInCommon(const regionCFG &other) const {
 }
  
 void regionCFG::toposort(std::vector<cfgBasicBlock*> &topo) const {
-  std::set<cfgBasicBlock*> visited;
+  std::vector<bool> visited(cfgBlocks.size(), false);
   std::function<void(cfgBasicBlock*)> dfs = [&](cfgBasicBlock *bb) {
     assert(bb != nullptr);
-    if(visited.find(bb) != visited.end())
+    if(visited[bb->id])
       return;
-    visited.insert(bb);
-    for(auto nbb : bb->getSuccs()) {
-      dfs(nbb);
+    visited[bb->id] = true;
+    for(uint32_t s : graph.succs(bb->id)) {
+      dfs(cfgBlocks[s]);
     }
     topo.push_back(bb);
   };
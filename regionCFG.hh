@@ -2,6 +2,7 @@
 #define __REGION_CFG_HH__
 
 #include <map>
+#include <deque>
 #include <unordered_map>
 #include <set>
 #include <bitset>
@@ -9,13 +10,18 @@
 #include <list>
 #include <array>
 #include <cstdint>
+#include <iostream>
 #include <limits.h>
 
 #include "execUnit.hh"
 #include "basicBlock.hh"
 #include "ssaInsn.hh"
-#include "pipeline_record.hh"
+#include "pipeline_store.hh"
+#include "profile.hh"
 #include "riscvInstruction.hh"
+#include "cfg_graph.hh"
+#include "dominators.hh"
+#include "ir_arena.hh"
 
 class regionCFG;
 class Insn;
@@ -38,28 +44,44 @@ class cfgBasicBlock {
   friend std::ostream &operator<<(std::ostream &out, const cfgBasicBlock &bb);
   friend class regionCFG;
   basicBlock *bb;
+  /* index in the owning regionCFG's cfgBlocks */
+  uint32_t id = 0;
   bool hasTermBranchOrJump;
   
   ssaRegTables ssaRegTbl;
   
   cfgBasicBlock *idombb;
-  std::set<cfgBasicBlock*> dtree_succs;
+  std::vector<cfgBasicBlock*> dtree_succs;
+  /* immediate post-dominator, nullptr for the virtual exit */
+  cfgBasicBlock *ipdombb = nullptr;
+  /* control dependence graph : the blocks whose branches decide if
+   * this one runs, the blocks this one's branch decides */
+  std::vector<cfgBasicBlock*> cdg_preds, cdg_succs;
+  /* innermost loop holding the block, nullptr outside loops */
+  naturalLoop *innerLoop = nullptr;
 
   std::vector<phiNode*> phiNodes;
   std::array<phiNode*,32> gprPhis;
 
 
-  std::set<cfgBasicBlock*> preds;
-  std::set<cfgBasicBlock*> succs;
-  std::set<cfgBasicBlock*> dfrontier;
+  std::vector<cfgBasicBlock*> preds;
+  std::vector<cfgBasicBlock*> succs;
+  std::vector<cfgBasicBlock*> dfrontier;
   std::vector<basicBlock::instruction> rawInsns;
   std::vector<Insn*> insns;
   std::vector<ssaInsn*> ssaInsns;
 
   
   std::bitset<32> gprRead;
+  /* written anywhere in the block, read before any write in it, and
+   * live over the region (see computeLiveness) */
+  std::bitset<32> gprWritten, gprUpExposed;
+  std::bitset<32> gprLiveIn, gprLiveOut;
   
   ssize_t dt_dfn = -1, dt_max_ancestor_dfn = -1;
+  uint32_t dt_depth = 0;
+  /* the last updateDominance search to visit the block */
+  uint64_t dt_visit = 0;
 
 
   void addPhiNode(gprPhiNode *phi);
@@ -84,16 +106,16 @@ class cfgBasicBlock {
   ~cfgBasicBlock();
   double computeTipCycles() const;
   
-  const std::set<cfgBasicBlock*> &getPreds() const {
+  const std::vector<cfgBasicBlock*> &getPreds() const {
     return preds;
   }
   size_t numSuccessors() const {
     return succs.size();
   }
-  const std::set<cfgBasicBlock*> &getSuccs() const {
+  const std::vector<cfgBasicBlock*> &getSuccs() const {
     return succs;
   }
-  const std::set<cfgBasicBlock*> &getDTSuccs() const {
+  const std::vector<cfgBasicBlock*> &getDTSuccs() const {
     return dtree_succs;
   }
   const std::vector<Insn*> &getInsns() const {
@@ -115,7 +137,7 @@ class cfgBasicBlock {
     return 0;
   }
   void addDTreeSucc(cfgBasicBlock *bb) {
-    dtree_succs.insert(bb);
+    dtree_succs.push_back(bb);
   }
   bool fastDominates(const cfgBasicBlock *B) const {
     /* Appel exercise 19.1 - constant time dominance */
@@ -124,15 +146,31 @@ class cfgBasicBlock {
   bool dominates(const cfgBasicBlock *B) const;
 };
 
+/* blocks by id rather than by address, so walks over a set of them
+ * (phi placement seeds from one) go the same way on every run */
+struct cfgBlockIdLess {
+  bool operator()(const cfgBasicBlock *a, const cfgBasicBlock *b) const {
+    return a->id < b->id;
+  }
+};
+typedef std::set<cfgBasicBlock*, cfgBlockIdLess> cfgBlockSet;
+
+
 
+/* per-block cycles/ipc report, hottest first */
+void writeHotBlocks(const std::string &filename,
+		    const std::set<const basicBlock*> &bbs,
+		    const pc_profile &prof,
+		    bool warn_missing = true,
+		    std::ostream &log = std::cout);
 
 std::ostream &operator<<(std::ostream &out, const regionCFG &cfg);
 class regionCFG : public execUnit {
 protected:
   std::string name;
-  std::map<int64_t, double> &tip;
-  std::map<uint64_t,uint64_t> &counts;
-  std::list<pipeline_record> &pt;
+  const pc_profile &prof;
+  const pipeline_store &pt;
+  /* every loop, outer loops first, and the outermost ones */
   std::vector<naturalLoop*> loops,nestedLoops;
   /* to be constructor list initialized */
   basicBlock *head = nullptr;
@@ -143,11 +181,32 @@ protected:
   bool perfectNest = false;
   bool hasBoth = false;
   bool validDominanceAcceleration = false;
+  /* progress and warnings, a region built on a worker thread logs
+   * into a buffer of its own */
+  std::ostream *log = &std::cout;
+  bool buildFromHead(const std::vector<std::pair<basicBlock*, basicBlock*>> &extra);
+  /* dominator tree numbers per block, see fastDominancePreComputation */
+  static constexpr ssize_t dtGap = 1 << 16;
+  uint64_t dtSearches = 0;
+  bool numberDTree(cfgBasicBlock *root, ssize_t lo, ssize_t hi);
+  void renumberDTree(cfgBasicBlock *bb);
+  bool growDTree(cfgBasicBlock *bb);
+  void placeDTrees(cfgBasicBlock *p, size_t k);
+  bool inDTree(const cfgBasicBlock *bb) const;
+  void updateDominance(cfgBasicBlock *from, cfgBasicBlock *to);
+  bool checkDominance();
   
  public:
   friend std::ostream &operator<<(std::ostream &out, const regionCFG &cfg);
   static uint64_t icnt;
   static uint64_t iters;
+  static dominators::engine domEngine;
+  /* minimal : a phi at every join in the iterated frontier of a def,
+   * semi_pruned : only for registers read before written in some block,
+   * pruned : only where the register is live in */
+  enum class ssaForm {minimal, semi_pruned, pruned};
+  static ssaForm phiPlacement;
+  static bool parseSSAForm(const std::string &s, ssaForm &f);
   static std::set<regionCFG*> regionCFGs;
 
   uint64_t &getuuid() {
@@ -159,37 +218,84 @@ protected:
   std::set<uint64_t> nextPCs;
   std::set<basicBlock*> blocks;
  
-  std::set<cfgBasicBlock*> gprDefinitionBlocks[32];
+  cfgBlockSet gprDefinitionBlocks[32];
 
-  std::bitset<32> allGprRead;
+  std::bitset<32> allGprRead, allGprUpExposed;
   std::vector< std::vector<naturalLoop> >loopNesting;
 
 
+  /* blocks live in the arena, cfgBlocks[id] points at block id */
+  std::deque<cfgBasicBlock> arena;
+  /* their instructions, phis and entry definitions, see getInsn */
+  ir_arena irArena;
   std::vector<cfgBasicBlock*> cfgBlocks;
   std::map<uint64_t, cfgBasicBlock*> cfgBlockMap;
+  /* id adjacency, built once the edges are final */
+  cfg_graph graph;
+
+  cfgBasicBlock *newBlock(basicBlock *bb);
+  void buildGraph();
 
   bool allBlocksReachable(cfgBasicBlock *root);
   void computeDominance();
   void computeDominanceFrontiers();
-  void computeLengauerTarjanDominance();
+  /* over the reversed graph from a virtual exit, which blocks leaving
+   * the region (and, in a region that never does, the bottom of each
+   * endless loop) fall into */
+  bool exitsRegion(const cfgBasicBlock *cbb) const;
+  void computePostDominance();
+  void computeControlDependence();
+  /* conditional branches by the TIP cycles of the blocks control
+   * dependent on them, to <name>_branches_<entry>.txt */
+  void writeBranchReport() const;
   void fastDominancePreComputation();
   void insertPhis();
   void getRegDefBlocks();
-  regionCFG(std::string name, std::map<int64_t, double> &m,
-	    std::map<uint64_t,uint64_t> &c, std::list<pipeline_record> &r);
+  void computeLiveness();
+  regionCFG(std::string name, const pc_profile &prof, const pipeline_store &r);
   ~regionCFG();
   bool buildCFG(std::vector<basicBlock*> &region);
+  /* region is single entry at entry, every block reachable from it
+   * over its successors and the extra (src, dst) edges */
+  bool buildCFG(std::vector<basicBlock*> &region, basicBlock *entry,
+		const std::vector<std::pair<basicBlock*, basicBlock*>> &extra);
+  void setLog(std::ostream &out) {
+    log = &out;
+  }
 
   bool analyzeGraph();
+  /* incremental dominance : idombb, dtree_succs, the depths and the
+   * fastDominates numbering are kept exact. the blocks that change
+   * idom are found by search from the edge's target and only their
+   * subtrees are renumbered, into numbers their new idom has spare.
+   * the id graph, frontiers, loops and SSA are left as they were,
+   * buildGraph and the passes after dominance redo them */
+  void insertEdge(cfgBasicBlock *from, cfgBasicBlock *to);
+  /* tail was split off cbb's basicBlock : a block for it takes over
+   * cbb's instructions from its entry on and cbb's successors */
+  cfgBasicBlock *splitBlock(cfgBasicBlock *cbb, basicBlock *tail);
+  /* random edge insertions and block splits on random regions of 100
+   * to 100K blocks, each update checked against a full recompute and
+   * timed against computeDominance plus fastDominancePreComputation.
+   * false if an update disagrees */
+  static bool benchIncremental(size_t runs);
+  /* follow mode : plays basicBlock::changes into this region with
+   * insertEdge and splitBlock, so its dominator tree tracks the
+   * blocks built so far. blocks carry no instructions, the first one
+   * logged is the head */
+  void followChanges();
+  /* back edges of the tree so far by how often they were taken, one
+   * line per loop header with its latches */
+  void writeLiveLoops(const std::string &filename) const;
   void dumpIR();
   void dumpRISCV();  
   void print();
   void asDot() const;
   void asText() const;
-  void findLoop(std::set<cfgBasicBlock*> &loop,
-		std::list<cfgBasicBlock*> &stack, 
-		cfgBasicBlock *hbb);
+  /* Havlak's loop nesting forest, irreducible loops included */
   void findNaturalLoops();
+  /* the forest with each loop's TIP cycles, to <name>_loops_<entry>.txt */
+  void writeLoopReport() const;
   void printNaturalLoops(int d = 0) const;
   bool dominates(cfgBasicBlock *A, cfgBasicBlock *B) const;
   uint64_t getEntryAddr() const override;
@@ -198,7 +304,9 @@ protected:
   uint64_t countInsns() const;
   uint64_t countBBs() const;
   uint64_t numBBInCommon(const regionCFG &other) const;
-  double getTipCycles(uint64_t ip) const;
+  const pc_profile &getProfile() const {
+    return prof;
+  }
 };
 
 #endif
@@ -102,6 +102,12 @@ static inline bool is_jr(uint32_t inst) {
   return (opcode == 0x67) and (rd == 0);
 }
 
+/* jr through a link register, a function return */
+static inline bool is_ret(uint32_t inst) {
+  riscv_t m(inst);
+  return is_jr(inst) and ((m.jj.rs1 == 1) or (m.jj.rs1 == 5));
+}
+
 static inline bool is_jalr(uint32_t inst) {
   uint32_t opcode = inst & 127;
   uint32_t rd = (inst>>7) & 31;
@@ -7,8 +7,6 @@
 #include "helper.hh"
 #include "globals.hh"
 
-uint64_t ssaInsn::uuid_counter = 0;
-
 std::ostream &operator<<(std::ostream &out, const Insn &ins) {
   out << "0x" << std::hex << ins.addr << std::dec 
       << " : " << getAsmString(ins.inst, ins.addr) 
@@ -16,11 +14,9 @@ std::ostream &operator<<(std::ostream &out, const Insn &ins) {
   return out;
 }
 
-void ssaInsn::makePrettyName() {
-  std::stringstream ss;
+std::string ssaInsn::getName() const {
   assert(destRegister() != -1);
-  ss << getGPRName(destRegister()) << "_" << uuid;
-  prettyName = ss.str(); 
+  return getGPRName(destRegister()) + "_" + std::to_string(uuid);
 }
 
 
@@ -58,6 +54,7 @@ public:
   void recDefines(cfgBasicBlock *cBB, regionCFG *cfg) override {
     if(r.l.rd != 0) {
       cfg->gprDefinitionBlocks[r.l.rd].insert(cBB);
+      cBB->gprWritten[r.l.rd]=true;
     }
   }
   void recUses(cfgBasicBlock *cBB) override {
@@ -88,6 +85,7 @@ public:
   void recDefines(cfgBasicBlock *cBB, regionCFG *cfg) override {
     if(r.a.rd != 0) {
       cfg->gprDefinitionBlocks[r.a.rd].insert(cBB);
+      cBB->gprWritten[r.a.rd]=true;
     }
   }
   void recUses(cfgBasicBlock *cBB) override {
@@ -171,6 +169,7 @@ public:
   void recDefines(cfgBasicBlock *cBB, regionCFG *cfg) override {
     if(rd != 0) {
       cfg->gprDefinitionBlocks[rd].insert(cBB);
+      cBB->gprWritten[rd]=true;
     }
   }
 };
@@ -187,6 +186,7 @@ public:
   void recDefines(cfgBasicBlock *cBB, regionCFG *cfg) override {
     if(rd != 0) {
       cfg->gprDefinitionBlocks[rd].insert(cBB);
+      cBB->gprWritten[rd]=true;
     }
   }
   void hookupRegs(MipsRegTable<ssaInsn> &tbl) override {
@@ -314,6 +314,7 @@ class insn_lui : public Insn {
   void recDefines(cfgBasicBlock *cBB, regionCFG *cfg) override {
     if(r.u.rd != 0) {
       cfg->gprDefinitionBlocks[r.u.rd].insert(cBB);
+      cBB->gprWritten[r.u.rd]=true;
     }
   }
   void hookupRegs(MipsRegTable<ssaInsn> &tbl) override {
@@ -347,6 +348,7 @@ class insn_auipc : public Insn {
   void recDefines(cfgBasicBlock *cBB, regionCFG *cfg) override {
     if(r.u.rd != 0) {
       cfg->gprDefinitionBlocks[r.u.rd].insert(cBB);
+      cBB->gprWritten[r.u.rd]=true;
     }
   }
   void hookupRegs(MipsRegTable<ssaInsn> &tbl) override {
@@ -443,6 +445,7 @@ void Insn::set(regionCFG *cfg, cfgBasicBlock *cBB) {
 void rTypeInsn::recDefines(cfgBasicBlock *cBB, regionCFG *cfg) {
   if(r.r.rd != 0) {
     cfg->gprDefinitionBlocks[r.r.rd].insert(cBB);
+    cBB->gprWritten[r.r.rd]=true;
   }
 }
 
@@ -622,6 +625,7 @@ void insn_j::dumpSSA(std::ostream &out) const {
 void insn_jalr::recDefines(cfgBasicBlock *cBB, regionCFG *cfg) {
   if(r.r.rd != 0) {
     cfg->gprDefinitionBlocks[r.r.rd].insert(cBB);
+    cBB->gprWritten[r.r.rd]=true;
   }
 }
 
@@ -661,6 +665,7 @@ void insn_jr::dumpSSA(std::ostream &out) const {
 void iTypeInsn::recDefines(cfgBasicBlock *cBB, regionCFG *cfg) {
   if(r.i.rd != 0) {
     cfg->gprDefinitionBlocks[r.i.rd].insert(cBB);
+    cBB->gprWritten[r.i.rd]=true;
   }
 }
 
@@ -953,6 +958,7 @@ void insn_jal::recDefines(cfgBasicBlock *cBB, regionCFG *cfg)  {
   assert(rd != 0);
   if(rd != 0) {
     cfg->gprDefinitionBlocks[rd].insert(cBB);
+    cBB->gprWritten[rd]=true;
   }
 }
 
@@ -1263,12 +1269,12 @@ public:
 };
 
 
-inline static Insn* decodeRtype(uint32_t inst, uint64_t addr){
+inline static Insn* decodeRtype(uint32_t inst, uint64_t addr, ir_arena &arena){
   uint32_t opcode = inst & 127;
   riscv_t m(inst);
   
   if(m.r.rd == 0) {
-    return new insn_nop(inst, addr);
+    return arena.make<insn_nop>(inst, addr);
   }
   
   if(opcode == 0x33) {
@@ -1276,111 +1282,111 @@ inline static Insn* decodeRtype(uint32_t inst, uint64_t addr){
       {
       case 0x0:
 	if(m.r.special == 0x0) {
-	  return new insn_add(inst, addr);
+	  return arena.make<insn_add>(inst, addr);
 	}
 	else if(m.r.special == 0x1) {
-	  return new insn_mul(inst, addr);
+	  return arena.make<insn_mul>(inst, addr);
 	}
 	else if(m.r.special == 0x20) {
-	  return new insn_sub(inst, addr);
+	  return arena.make<insn_sub>(inst, addr);
 	}
 	break;
       case 0x1:
 	if(m.r.special == 0x0) {
-	  return new insn_sll(inst, addr);
+	  return arena.make<insn_sll>(inst, addr);
 	}
 	else if(m.r.special == 0x1) {
-	  return new insn_mulh(inst, addr);
+	  return arena.make<insn_mulh>(inst, addr);
 	}
 	else if(m.r.special == 0x30) {
-	  return new insn_rol(inst, addr);
+	  return arena.make<insn_rol>(inst, addr);
 	}
 	break;
       case 0x2:
 	if(m.r.special == 0x0) {
-	  return new insn_slt(inst, addr);
+	  return arena.make<insn_slt>(inst, addr);
 	}
 	else if(m.r.special == 0x10) {
-	  return new insn_sh1add(inst, addr);
+	  return arena.make<insn_sh1add>(inst, addr);
 	}
 	break;
       case 0x3:
 	if(m.r.special == 0x0) {
-	  return new insn_sltu(inst, addr);
+	  return arena.make<insn_sltu>(inst, addr);
 	}
 	else if(m.r.special == 0x1) {
-	  return new insn_mulhu(inst, addr);
+	  return arena.make<insn_mulhu>(inst, addr);
 	}
 	break;
       case 0x4:
 	if(m.r.special == 0x0) {
-	  return new insn_xor(inst, addr);
+	  return arena.make<insn_xor>(inst, addr);
 	}
 	else if(m.r.special == 0x1) {
-	  return new insn_div(inst, addr);
+	  return arena.make<insn_div>(inst, addr);
 	}
 	else if(m.r.special == 0x5) {
-	  return new insn_min(inst, addr);
+	  return arena.make<insn_min>(inst, addr);
 	}
 	else if(m.r.special == 0x10) {
-	  return new insn_sh2add(inst, addr);
+	  return arena.make<insn_sh2add>(inst, addr);
 	}
 	else if(m.r.special == 0x20) {
-	  return new insn_xnor(inst, addr);
+	  return arena.make<insn_xnor>(inst, addr);
 	}
 	break;
       case 0x5:
 	if(m.r.special == 0x0) {
-	  return new insn_srl(inst, addr);
+	  return arena.make<insn_srl>(inst, addr);
 	}
 	else if(m.r.special == 0x1) {
-	  return new insn_divu(inst, addr);
+	  return arena.make<insn_divu>(inst, addr);
 	}
 	else if(m.r.special == 0x5) {
-	  return new insn_minu(inst, addr);
+	  return arena.make<insn_minu>(inst, addr);
 	}
 	else if(m.r.special == 0x7) {
-	  return new insn_czeqz(inst, addr);
+	  return arena.make<insn_czeqz>(inst, addr);
 	}
 	else if(m.r.special == 0x20) {
-	  return new insn_sra(inst, addr);
+	  return arena.make<insn_sra>(inst, addr);
 	}
 	else if(m.r.special == 0x30) {
-	  return new insn_ror(inst, addr);
+	  return arena.make<insn_ror>(inst, addr);
 	}	
 	break;
       case 0x6:
 	if(m.r.special == 0x0) {
-	  return new insn_or(inst, addr);
+	  return arena.make<insn_or>(inst, addr);
 	}
 	else if(m.r.special == 0x1) {
-	  return new insn_rem(inst, addr);
+	  return arena.make<insn_rem>(inst, addr);
 	}
 	else if(m.r.special == 0x5) {
-	  return new insn_max(inst, addr);
+	  return arena.make<insn_max>(inst, addr);
 	}
 	else if(m.r.special == 0x10) {
-	  return new insn_sh3add(inst, addr);
+	  return arena.make<insn_sh3add>(inst, addr);
 	}
 	else if(m.r.special == 0x20) {
-	  return new insn_orn(inst, addr);
+	  return arena.make<insn_orn>(inst, addr);
 	}	
 	break;
       case 0x7:
 	if(m.r.special == 0x0) {
-	  return new insn_and(inst, addr);
+	  return arena.make<insn_and>(inst, addr);
 	}
 	else if(m.r.special == 0x1) {
-	  return new insn_remu(inst, addr);
+	  return arena.make<insn_remu>(inst, addr);
 	}
 	else if(m.r.special == 0x5) {
-	  return new insn_maxu(inst, addr);
+	  return arena.make<insn_maxu>(inst, addr);
 	}
 	else if(m.r.special == 0x7) {
-	  return new insn_cznez(inst, addr);
+	  return arena.make<insn_cznez>(inst, addr);
 	}
 	else if(m.r.special == 0x20) {
-	  return new insn_andn(inst, addr);
+	  return arena.make<insn_andn>(inst, addr);
 	}
 	break;
       default:
@@ -1395,13 +1401,13 @@ inline static Insn* decodeRtype(uint32_t inst, uint64_t addr){
 	  switch(m.r.special)
 	    {
 	    case 0:
-	      return new insn_addw(inst, addr);
+	      return arena.make<insn_addw>(inst, addr);
 	    case 1:
-	      return new insn_mulw(inst, addr);
+	      return arena.make<insn_mulw>(inst, addr);
 	    case 4:
-	      return new insn_adduw(inst, addr);
+	      return arena.make<insn_adduw>(inst, addr);
 	    case 32:
-	      return new insn_subw(inst, addr);
+	      return arena.make<insn_subw>(inst, addr);
 	    default:
 	      break;
 	    }
@@ -1409,26 +1415,26 @@ inline static Insn* decodeRtype(uint32_t inst, uint64_t addr){
 	}
       case 1:
 	if(m.r.special == 0) {
-	  return new insn_sllw(inst, addr);
+	  return arena.make<insn_sllw>(inst, addr);
 	}
 	else if(m.r.special == 0x30) {
-	  return new insn_rolw(inst, addr);
+	  return arena.make<insn_rolw>(inst, addr);
 	}
 	break;
       case 2:
 	if(m.r.special == 16) {
-	  return new insn_sh1adduw(inst, addr);
+	  return arena.make<insn_sh1adduw>(inst, addr);
 	}
 	break;
       case 4:
 	switch(m.r.special)
 	  {
 	  case 1:
-	    return new insn_divw(inst, addr);
+	    return arena.make<insn_divw>(inst, addr);
 	  case 4:
-	    return new insn_zexth(inst, addr);
+	    return arena.make<insn_zexth>(inst, addr);
 	  case 16:
-	    return new insn_sh2adduw(inst, addr);
+	    return arena.make<insn_sh2adduw>(inst, addr);
 	  default:
 	    break;
 	  }
@@ -1437,35 +1443,35 @@ inline static Insn* decodeRtype(uint32_t inst, uint64_t addr){
 	switch(m.r.special)
 	  {
 	  case 0:
-	    return new insn_srlw(inst, addr);
+	    return arena.make<insn_srlw>(inst, addr);
 	  case 1:
-	    return new insn_divuw(inst, addr);
+	    return arena.make<insn_divuw>(inst, addr);
 	  case 32:
-	    return new insn_sraw(inst, addr);
+	    return arena.make<insn_sraw>(inst, addr);
 	  case 0x30:
-	    return new insn_rorw(inst, addr);
+	    return arena.make<insn_rorw>(inst, addr);
 	  default:
 	    break;
 	  }
 	break;
       case 6:
 	if(m.r.special == 1) {
-	  return new insn_remw(inst, addr);
+	  return arena.make<insn_remw>(inst, addr);
 	}
 	break;
       case 7:
 	if(m.r.special == 1) {
-	  return new insn_remuw(inst, addr);
+	  return arena.make<insn_remuw>(inst, addr);
 	}
       default:
 	break;
       }
   }
-  return new rTypeInsn(inst, addr);  
+  return arena.make<rTypeInsn>(inst, addr);  
 }
 
 
-Insn* getInsn(uint32_t inst, uint64_t addr){
+Insn* getInsn(uint32_t inst, uint64_t addr, ir_arena &arena){
   uint32_t opcode = inst & 127;
   uint32_t rd = (inst>>7) & 31;
   riscv_t m(inst);
@@ -1476,174 +1482,174 @@ Insn* getInsn(uint32_t inst, uint64_t addr){
       switch(m.r.sel)
 	{
 	case 0x0: /* lb */
-	  return new insn_lb(inst, addr);
+	  return arena.make<insn_lb>(inst, addr);
 	case 0x1: /* lh */
-	  return new insn_lh(inst, addr);
+	  return arena.make<insn_lh>(inst, addr);
 	case 0x2: /* lw */
-	  return new insn_lw(inst, addr);
+	  return arena.make<insn_lw>(inst, addr);
 	case 0x3: /* ld */
-	  return new insn_ld(inst, addr);
+	  return arena.make<insn_ld>(inst, addr);
 	case 0x4: /* lbu */
-	  return new insn_lbu(inst, addr);
+	  return arena.make<insn_lbu>(inst, addr);
 	case 0x5:  /* lhu */
-	  return new insn_lhu(inst, addr);
+	  return arena.make<insn_lhu>(inst, addr);
 	case 0x6: /* lwu */
-	  return new insn_lwu(inst, addr);
+	  return arena.make<insn_lwu>(inst, addr);
 	}
       break;
     case 0xf:  /* fence - there's a bunch of 'em */
-      return new fenceInsn(inst, addr);
+      return arena.make<fenceInsn>(inst, addr);
     case 0x13: { /* reg + imm insns */
       if ( (((inst>>12) & 7) == 0) and (rd == 0)) {
-	return new insn_nop(inst, addr);
+	return arena.make<insn_nop>(inst, addr);
       }
       else {
 	if(m.i.sel == 0) {
-	  return ((inst >> 20) == 0) ? reinterpret_cast<Insn*>(new insn_mv(inst, addr)) :
-	    reinterpret_cast<Insn*>(new insn_addi(inst, addr));
+	  return ((inst >> 20) == 0) ? reinterpret_cast<Insn*>(arena.make<insn_mv>(inst, addr)) :
+	    reinterpret_cast<Insn*>(arena.make<insn_addi>(inst, addr));
 	}
 	else if(m.i.sel == 1) {
 	  switch((inst>>20) & 4095)
 	    {
 	    case 0x600:
-	      return new insn_clz(inst,addr);
+	      return arena.make<insn_clz>(inst,addr);
 	    case 0x601:
-	      return new insn_ctz(inst,addr);	      
+	      return arena.make<insn_ctz>(inst,addr);	      
 	    case 0x602:
-	      return new insn_cpop(inst,addr);
+	      return arena.make<insn_cpop>(inst,addr);
 	    case 0x604:
-	      return new insn_sextb(inst,addr);
+	      return arena.make<insn_sextb>(inst,addr);
 	    case 0x605:
-	      return new insn_sexth(inst,addr);
+	      return arena.make<insn_sexth>(inst,addr);
 	    default:
 	      break;
 	    }
-	  return new insn_slli(inst, addr);	  
+	  return arena.make<insn_slli>(inst, addr);	  
 	}
 	else if(m.i.sel == 2) {
-	  return new insn_slti(inst, addr);
+	  return arena.make<insn_slti>(inst, addr);
 	}
 	else if(m.i.sel == 3) {
-	  return new insn_sltiu(inst, addr);
+	  return arena.make<insn_sltiu>(inst, addr);
 	}	
 	else if(m.i.sel == 4) {
-	  return new insn_xori(inst, addr);
+	  return arena.make<insn_xori>(inst, addr);
 	}
 	else if(m.i.sel == 5) {
 	  switch((inst>>26) & 63)
 	    {
 	    case 0x0:
-	      return new insn_srli(inst, addr);
+	      return arena.make<insn_srli>(inst, addr);
 	    case 0xa:
-	      return new insn_orcb(inst, addr);
+	      return arena.make<insn_orcb>(inst, addr);
 	    case 0x10:
-	      return new insn_srai(inst, addr);
+	      return arena.make<insn_srai>(inst, addr);
 	    case 0x18:
-	      return new insn_rori(inst, addr);
+	      return arena.make<insn_rori>(inst, addr);
 	    case 0x1a:
-	      return new insn_rev8(inst, addr);
+	      return arena.make<insn_rev8>(inst, addr);
 	    default:
 	      break;
 	    }
-	  return new iTypeInsn(inst, addr);
+	  return arena.make<iTypeInsn>(inst, addr);
 	}
 	else if(m.i.sel == 6) {
-	  return new insn_ori(inst, addr);
+	  return arena.make<insn_ori>(inst, addr);
 	}
 	else {
-	  return new insn_andi(inst, addr);
+	  return arena.make<insn_andi>(inst, addr);
 	}
       }
     }
     case 0x17: /* auipc */
-      return new insn_auipc(inst, addr);
+      return arena.make<insn_auipc>(inst, addr);
     case 0x1b: {
       if ( (((inst>>12) & 7) == 0) and (rd == 0)) {
-	return new insn_nop(inst, addr);
+	return arena.make<insn_nop>(inst, addr);
       }
       else if(m.i.sel == 0) {
-	return new insn_addiw(inst, addr);
+	return arena.make<insn_addiw>(inst, addr);
       }
       else if(m.i.sel == 1) {
 	uint32_t sel = ((inst>>26)&63);
 	if(sel == 0) {
-	  return new insn_slliw(inst, addr);
+	  return arena.make<insn_slliw>(inst, addr);
 	}
 	else if(sel == 2) {
-	  return new insn_slliuw(inst, addr);
+	  return arena.make<insn_slliuw>(inst, addr);
 	}
 	else if(sel == 0x18) {
 	  if( ((inst>>20)&31) == 0) {
-	    return new insn_clzw(inst, addr);
+	    return arena.make<insn_clzw>(inst, addr);
 	  }
 	  else if(((inst>>20)&31) == 1) {
-	    return new insn_ctzw(inst, addr);
+	    return arena.make<insn_ctzw>(inst, addr);
 	  }
 	  else if(((inst>>20)&31) == 1) {
-	    return new insn_cpopw(inst, addr);
+	    return arena.make<insn_cpopw>(inst, addr);
 	  }	  
 	}
       }
       else if(m.i.sel == 5) {
 	uint32_t sel =  (inst >> 25) & 127;
 	if(sel == 0x0) {
-	  return new insn_srliw(inst, addr);
+	  return arena.make<insn_srliw>(inst, addr);
 	}
 	else if(sel == 0x20) {
-	  return new insn_sraiw(inst, addr);
+	  return arena.make<insn_sraiw>(inst, addr);
 	}
 	else if(sel == 0x30) {
-	  return new insn_roriw(inst, addr);
+	  return arena.make<insn_roriw>(inst, addr);
 	}
       }
-      return new iTypeInsn(inst, addr);
+      return arena.make<iTypeInsn>(inst, addr);
     }
     case 0x23: {/* stores */
       switch(m.s.sel)
 	{
 	case 0x0: /* sb */
-	  return new insn_sb(inst, addr);
+	  return arena.make<insn_sb>(inst, addr);
 	case 0x1: /* sh */
-	  return new insn_sh(inst, addr);
+	  return arena.make<insn_sh>(inst, addr);
 	case 0x2: /* sw */
-	  return new insn_sw(inst, addr);
+	  return arena.make<insn_sw>(inst, addr);
 	case 0x3: /* sd */
-	  return new insn_sd(inst, addr);
+	  return arena.make<insn_sd>(inst, addr);
 	default:
 	  break;
 	}
       break;
     }
     case 0x2f:
-      return new atomicInsn(inst, addr);
+      return arena.make<atomicInsn>(inst, addr);
     case 0x37: /* lui */
-      return new insn_lui(inst, addr);
+      return arena.make<insn_lui>(inst, addr);
     case 0x67: {/* jalr */
-      return (rd==0) ? dynamic_cast<Insn*>(new insn_jr(inst, addr)) :
-	dynamic_cast<Insn*>(new insn_jalr(inst,addr));
+      return (rd==0) ? dynamic_cast<Insn*>(arena.make<insn_jr>(inst, addr)) :
+	dynamic_cast<Insn*>(arena.make<insn_jalr>(inst,addr));
     }
     case 0x6f: {/* jal */
-      return (rd==0) ? dynamic_cast<Insn*>(new insn_j(inst, addr)) :
-	dynamic_cast<Insn*>(new insn_jal(inst,addr));
+      return (rd==0) ? dynamic_cast<Insn*>(arena.make<insn_j>(inst, addr)) :
+	dynamic_cast<Insn*>(arena.make<insn_jal>(inst,addr));
     }
     case 0x33:
     case 0x3b: /* reg + reg insns */
-      return decodeRtype(inst, addr);
+      return decodeRtype(inst, addr, arena);
     case 0x63: /* branches */
       switch(m.b.sel)
 	{
 	case 0: /* beq */
-	  return new insn_beq(inst, addr);
+	  return arena.make<insn_beq>(inst, addr);
 	case 1: /* bne */
-	  return new insn_bne(inst, addr);
+	  return arena.make<insn_bne>(inst, addr);
 	case 4: /* blt */
-	  return new insn_blt(inst, addr);
+	  return arena.make<insn_blt>(inst, addr);
 	case 5: /* bge */
-	  return new insn_bge(inst, addr);
+	  return arena.make<insn_bge>(inst, addr);
 	case 6: /* bltu */
-	  return new insn_bltu(inst, addr);
+	  return arena.make<insn_bltu>(inst, addr);
 	case 7: /* bgeu */
-	  return new insn_bgeu(inst, addr);
+	  return arena.make<insn_bgeu>(inst, addr);
 	default:
 	  break;
 	}
@@ -1658,47 +1664,47 @@ Insn* getInsn(uint32_t inst, uint64_t addr){
 	die();
       }
       else if(upper7 == 9 && ((inst & (16384-1)) == 0x73 )) {
-	return new sfenceInsn(inst, addr);
+	return arena.make<sfenceInsn>(inst, addr);
       }
       else if(bits19to7z and (csr_id == 0x105)) {
 	/* wfi */
-	return new wfiInsn(inst, addr);
+	return arena.make<wfiInsn>(inst, addr);
       }
       else if(bits19to7z and (csr_id == 0x002)) {  /* uret */
 	assert(false);
       }
       else if(bits19to7z and (csr_id == 0x102)) {  /* sret */
-	return new sretInsn(inst, addr);
+	return arena.make<sretInsn>(inst, addr);
       }
       else if(bits19to7z and (csr_id == 0x202)) {  /* hret */
 	die();
       }            
       else if(bits19to7z and (csr_id == 0x302)) {  /* mret */
-	return new mretInsn(inst, addr);
+	return arena.make<mretInsn>(inst, addr);
       }
       else if(is_ebreak) {
-	return new ebreakInsn(inst, addr);
+	return arena.make<ebreakInsn>(inst, addr);
       }
       else {
 	switch((inst>>12) & 7)
 	  {	    
 	  case 1: { /* CSRRW */
-	    return new csrrwInsn(inst, addr);
+	    return arena.make<csrrwInsn>(inst, addr);
 	  }
 	  case 2: {/* CSRRS */
-	    return new csrrsInsn(inst, addr);
+	    return arena.make<csrrsInsn>(inst, addr);
 	  }
 	  case 3: {/* CSRRC */
-	    return new csrrcInsn(inst, addr);
+	    return arena.make<csrrcInsn>(inst, addr);
 	  }
 	  case 5: {/* CSRRWI */
-	    return new csriInsn(inst, addr);
+	    return arena.make<csriInsn>(inst, addr);
 	  }
 	  case 6:{ /* CSRRSI */
-	    return new csriInsn(inst, addr);
+	    return arena.make<csriInsn>(inst, addr);
 	  }
 	  case 7: {/* CSRRCI */
-	    return new csriInsn(inst, addr);	    
+	    return arena.make<csriInsn>(inst, addr);	    
 	  }
 	  default:
 	    break;
@@ -1718,7 +1724,7 @@ Insn* getInsn(uint32_t inst, uint64_t addr){
       break;
     }
   
-  return new Insn(inst, addr);
+  return arena.make<Insn>(inst, addr);
 }
 
 
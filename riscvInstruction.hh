@@ -5,6 +5,7 @@
 #include <cstdint>
 #include "ssaInsn.hh"
 #include "riscv.hh"
+#include "ir_arena.hh"
 
 class cfgBasicBlock;
 class regionCFG;
@@ -13,7 +14,8 @@ class Insn;
 enum regEnum {uninit=0,constant,variant};
 enum opPrecType {integerprec=0,singleprec,doubleprec,fpspecialprec,unknownprec,dummyprec};
 
-Insn* getInsn(uint32_t inst, uint64_t addr);
+/* decoded into the owning region's arena */
+Insn* getInsn(uint32_t inst, uint64_t addr, ir_arena &arena);
 
 class Insn : public ssaInsn {
 protected:
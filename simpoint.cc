@@ -0,0 +1,225 @@
+#include <cmath>
+#include <limits>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "simpoint.hh"
+
+simpoint::simpoint(uint64_t interval, size_t dims, const std::vector<uint32_t> &block_of,
+		   size_t num_blocks, uint64_t seed) :
+  interval(interval), dims(dims), block_of(block_of),
+  proj((num_blocks + 1) * dims), bbv(num_blocks + 1, 0) {
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> u(-1.0, 1.0);
+  for(double &p : proj) {
+    p = u(rng);
+  }
+}
+
+void simpoint::close_interval() {
+  if(curr_len == 0) {
+    return;
+  }
+  size_t o = vecs.size();
+  vecs.resize(o + dims, 0.0);
+  for(uint32_t b : touched) {
+    double f = static_cast<double>(bbv[b]) / curr_len;
+    for(size_t d = 0; d < dims; d++) {
+      vecs[o + d] += f * proj[b*dims + d];
+    }
+    bbv[b] = 0;
+  }
+  touched.clear();
+  starts.push_back(n);
+  lens.push_back(curr_len);
+  n += curr_len;
+  curr_len = 0;
+}
+
+static double dist2(const double *a, const double *b, size_t dims) {
+  double s = 0.0;
+  for(size_t d = 0; d < dims; d++) {
+    s += (a[d] - b[d]) * (a[d] - b[d]);
+  }
+  return s;
+}
+
+/* k-means++ seeding then Lloyd iterations, returns the distortion */
+double simpoint::kmeans(size_t k, uint64_t seed, std::vector<size_t> &assign,
+			std::vector<double> &centers) const {
+  const size_t r = starts.size();
+  std::mt19937_64 rng(seed);
+  std::vector<double> d2(r, std::numeric_limits<double>::max());
+  centers.assign(k * dims, 0.0);
+  assign.assign(r, 0);
+  size_t c = std::uniform_int_distribution<size_t>(0, r - 1)(rng);
+  for(size_t j = 0; j < k; j++) {
+    std::copy_n(&vecs[c*dims], dims, &centers[j*dims]);
+    double tot = 0.0;
+    for(size_t i = 0; i < r; i++) {
+      d2[i] = std::min(d2[i], dist2(&vecs[i*dims], &centers[j*dims], dims));
+      tot += d2[i];
+    }
+    if(tot == 0.0) {
+      c = std::uniform_int_distribution<size_t>(0, r - 1)(rng);
+      continue;
+    }
+    double x = std::uniform_real_distribution<double>(0.0, tot)(rng);
+    for(c = 0; c < (r - 1); c++) {
+      x -= d2[c];
+      if(x <= 0.0) {
+	break;
+      }
+    }
+  }
+
+  double distortion = 0.0;
+  for(size_t iter = 0; iter < 100; iter++) {
+    bool changed = false;
+    distortion = 0.0;
+    for(size_t i = 0; i < r; i++) {
+      size_t best = 0;
+      double bd = std::numeric_limits<double>::max();
+      for(size_t j = 0; j < k; j++) {
+	double t = dist2(&vecs[i*dims], &centers[j*dims], dims);
+	if(t < bd) {
+	  bd = t;
+	  best = j;
+	}
+      }
+      changed |= (assign[i] != best);
+      assign[i] = best;
+      distortion += bd;
+    }
+    if(iter and not(changed)) {
+      break;
+    }
+    std::vector<size_t> cnt(k, 0);
+    std::fill(centers.begin(), centers.end(), 0.0);
+    for(size_t i = 0; i < r; i++) {
+      cnt[assign[i]]++;
+      for(size_t d = 0; d < dims; d++) {
+	centers[assign[i]*dims + d] += vecs[i*dims + d];
+      }
+    }
+    for(size_t j = 0; j < k; j++) {
+      for(size_t d = 0; cnt[j] and (d < dims); d++) {
+	centers[j*dims + d] /= cnt[j];
+      }
+    }
+  }
+  return distortion;
+}
+
+/* spherical gaussian BIC as in x-means / SimPoint 3 */
+double simpoint::bic(size_t k, const std::vector<size_t> &assign,
+		     const std::vector<double> &centers) const {
+  const double r = starts.size(), m = dims;
+  std::vector<double> rn(k, 0.0);
+  double sse = 0.0;
+  for(size_t i = 0; i < starts.size(); i++) {
+    rn[assign[i]] += 1.0;
+    sse += dist2(&vecs[i*dims], &centers[assign[i]*dims], dims);
+  }
+  if(r <= k) {
+    return 0.0;
+  }
+  double var = std::max(sse / (r - k), std::numeric_limits<double>::min());
+  double l = 0.0;
+  for(size_t j = 0; j < k; j++) {
+    if(rn[j] == 0.0) {
+      continue;
+    }
+    l += -rn[j]/2.0 * std::log(2.0*M_PI) - rn[j]*m/2.0 * std::log(var)
+      - (rn[j] - k)/2.0 + rn[j]*std::log(rn[j]) - rn[j]*std::log(r);
+  }
+  double p = (k - 1) + m*k + 1;
+  return l - p/2.0 * std::log(r);
+}
+
+std::vector<simpoint::point> simpoint::pick(size_t max_k, uint64_t seed) {
+  close_interval();
+  std::vector<point> pts;
+  const size_t r = starts.size();
+  if(r == 0) {
+    return pts;
+  }
+  max_k = std::max(static_cast<size_t>(1), std::min(max_k, r));
+  std::vector<std::vector<size_t>> assigns(max_k + 1);
+  std::vector<std::vector<double>> centers(max_k + 1);
+  std::vector<double> scores(max_k + 1, 0.0);
+  for(size_t k = 1; k <= max_k; k++) {
+    kmeans(k, seed + k, assigns[k], centers[k]);
+    scores[k] = bic(k, assigns[k], centers[k]);
+  }
+  auto mm = std::minmax_element(scores.begin() + 1, scores.end());
+  double thresh = *mm.first + 0.9 * (*mm.second - *mm.first);
+  size_t k = 1;
+  while((k < max_k) and (scores[k] < thresh)) {
+    k++;
+  }
+
+  /* the interval nearest each centroid stands in for its cluster */
+  const std::vector<size_t> &a = assigns[k];
+  const std::vector<double> &c = centers[k];
+  std::vector<uint64_t> covered(k, 0);
+  std::vector<size_t> rep(k, r);
+  std::vector<double> rd(k, std::numeric_limits<double>::max());
+  for(size_t i = 0; i < r; i++) {
+    size_t j = a[i];
+    covered[j] += lens[i];
+    double d = dist2(&vecs[i*dims], &c[j*dims], dims);
+    if(d < rd[j]) {
+      rd[j] = d;
+      rep[j] = i;
+    }
+  }
+  for(size_t j = 0; j < k; j++) {
+    if(rep[j] == r) {
+      continue;
+    }
+    pts.push_back(point{starts[rep[j]], lens[rep[j]],
+	  static_cast<double>(covered[j]) / n, j});
+  }
+  std::sort(pts.begin(), pts.end(), [](const point &x, const point &y) {
+      return x.start < y.start;
+    });
+  return pts;
+}
+
+bool simpoint::write(const std::string &fname, const std::vector<point> &pts) {
+  std::ofstream out(fname);
+  if(not(out.good())) {
+    return false;
+  }
+  out << "# start len weight cluster\n";
+  for(const point &p : pts) {
+    out << p.start << " " << p.len << " " << p.weight << " " << p.cluster << "\n";
+  }
+  return out.good();
+}
+
+bool simpoint::read(const std::string &fname, std::vector<point> &pts) {
+  std::ifstream in(fname);
+  if(not(in.good())) {
+    return false;
+  }
+  std::string line;
+  while(std::getline(in, line)) {
+    if(line.empty() or line[0] == '#') {
+      continue;
+    }
+    std::istringstream ss(line);
+    point p;
+    if(not(ss >> p.start >> p.len >> p.weight >> p.cluster)) {
+      return false;
+    }
+    pts.push_back(p);
+  }
+  std::sort(pts.begin(), pts.end(), [](const point &x, const point &y) {
+      return x.start < y.start;
+    });
+  return true;
+}
@@ -0,0 +1,62 @@
+#ifndef __simpoint_hh__
+#define __simpoint_hh__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* SimPoint style sampling : the trace is cut into fixed size
+ * intervals, each summarized by its basic block vector (instructions
+ * retired per block) randomly projected down to a few dimensions;
+ * k-means over those picks one representative interval per phase */
+class simpoint {
+public:
+  struct point {
+    uint64_t start, len;
+    /* fraction of the trace the point's cluster covers */
+    double weight;
+    size_t cluster;
+  };
+private:
+  uint64_t interval;
+  size_t dims;
+  /* block of each profile index, projection row of each block */
+  std::vector<uint32_t> block_of;
+  std::vector<double> proj;
+  std::vector<uint32_t> bbv;
+  std::vector<uint32_t> touched;
+  uint64_t n = 0, curr_len = 0;
+  std::vector<uint64_t> starts, lens;
+  std::vector<double> vecs;
+  void close_interval();
+  double kmeans(size_t k, uint64_t seed, std::vector<size_t> &assign,
+		std::vector<double> &centers) const;
+  double bic(size_t k, const std::vector<size_t> &assign,
+	     const std::vector<double> &centers) const;
+public:
+  /* block_of maps a pc_profile index to a dense block id */
+  simpoint(uint64_t interval, size_t dims, const std::vector<uint32_t> &block_of,
+	   size_t num_blocks, uint64_t seed);
+  /* every record in trace order, by profile index; pcs outside
+   * every block share one extra dimension */
+  void add(uint32_t prof) {
+    uint32_t b = (prof < block_of.size()) ? block_of[prof] : (bbv.size() - 1);
+    if(bbv[b]++ == 0) {
+      touched.push_back(b);
+    }
+    if(++curr_len == interval) {
+      close_interval();
+    }
+  }
+  size_t num_intervals() const {
+    return starts.size();
+  }
+  /* clusters with k up to max_k and keeps the smallest k whose
+   * BIC score is within 90% of the best */
+  std::vector<point> pick(size_t max_k, uint64_t seed);
+  static bool write(const std::string &fname, const std::vector<point> &pts);
+  static bool read(const std::string &fname, std::vector<point> &pts);
+};
+
+#endif
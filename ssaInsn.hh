@@ -1,8 +1,9 @@
 #ifndef __ssainsn_hh__
 #define __ssainsn_hh__
 
+#include <algorithm>
 #include <array>
-#include <set>
+#include <string>
 #include <list>
 #include <vector>
 #include "helper.hh"
@@ -29,29 +30,31 @@ protected:
   int32_t gprId;  
   insnDefType insnType;  
   uint64_t uuid;
-  std::set<ssaInsn*> uses;
+  /* a user reads its sources one after another (and a phi over each
+   * in-edge in turn), so a repeat is always the last entry */
+  std::vector<ssaInsn*> uses;
   std::vector<ssaInsn*> sources;
-  std::string prettyName;
-  static uint64_t uuid_counter;
+  /* numbered by the region's ir_arena, in the order it makes them */
+  friend class ir_arena;
 public:
   ssaInsn(int32_t gprId, insnDefType insnType = insnDefType::unknown) :
-    gprId(gprId),insnType(insnType), uuid(uuid_counter++) {
+    gprId(gprId),insnType(insnType), uuid(0) {
   }
   virtual ~ssaInsn() {}    
-  const std::string &getName() const {
-    return prettyName;
-  }
-  void makePrettyName();
+  /* built when dumping rather than kept per instruction */
+  std::string getName() const;
   void addUse(ssaInsn *u) {
-    uses.insert(u);
+    if(uses.empty() or (uses.back() != u)) {
+      uses.push_back(u);
+    }
+  }
+  void delUse(const ssaInsn *u) {
+    uses.erase(std::remove(uses.begin(), uses.end(), u), uses.end());
   }
   bool noUses() const {
     return uses.empty();
   }
-  const std::set<ssaInsn*>& getUses() const {
-    return uses;
-  }
-  std::set<ssaInsn*>& getUses() {
+  const std::vector<ssaInsn*>& getUses() const {
     return uses;
   }
   const std::vector<ssaInsn*> &getSources() const {
@@ -62,7 +65,7 @@ public:
   }
   void addSrc(ssaInsn *src) {
     sources.push_back(src);
-    src->uses.insert(this);
+    src->addUse(this);
   }
   virtual int32_t destRegister() const {
     return gprId;
@@ -97,6 +100,15 @@ class phiNode : public ssaInsn {
   virtual void print() const = 0;
   virtual void addIncomingEdge(regionCFG *cfg, cfgBasicBlock *b)  = 0;
   virtual void dumpSSA(std::ostream &out) const override;
+  const std::vector<std::pair<cfgBasicBlock*, ssaInsn*>> &getInBoundEdges() const {
+    return inBoundEdges;
+  }
+  /* drop this phi from the uses of the values flowing into it */
+  void unlink() {
+    for(auto &e : inBoundEdges) {
+      e.second->delUse(this);
+    }
+  }
 };
 
 class gprPhiNode : public phiNode {
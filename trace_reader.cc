@@ -0,0 +1,54 @@
+#include <iostream>
+#include <algorithm>
+
+#include "trace_reader.hh"
+#include "columnar_trace.hh"
+#include "compressed_trace.hh"
+
+archive_trace_reader::archive_trace_reader(const std::string &fname) :
+  ifs(fname, std::ios::binary), ia(ifs) {
+  using namespace boost::serialization;
+  archive_preamble<retire_trace> rt_preamble;
+  archive_preamble<std::list<inst_record>> list_preamble;
+  ia >> rt_preamble;
+  ia >> list_preamble;
+  /* same steps as boost's std::list loader */
+  collection_size_type count;
+  ia >> count;
+  if(boost::archive::library_version_type(3) < ia.get_library_version()) {
+    item_version_type item_version(0);
+    ia >> item_version;
+  }
+  remaining = total = count;
+  if(remaining == 0) {
+    ia >> tip;
+  }
+}
+
+size_t archive_trace_reader::read(std::vector<inst_record> &chunk, size_t max) {
+  size_t n = std::min(static_cast<uint64_t>(max), remaining);
+  for(size_t i = 0; i < n; i++) {
+    inst_record r;
+    ia >> r;
+    chunk.push_back(r);
+  }
+  remaining -= n;
+  /* tip map follows the records in the archive */
+  if(n != 0 and remaining == 0) {
+    ia >> tip;
+  }
+  return n;
+}
+
+trace_reader *open_trace_reader(const std::string &fname, size_t threads) {
+  if(columnar_trace::is_columnar(fname)) {
+    return new columnar_trace_reader(fname);
+  }
+  if(compressed_trace::is_compressed(fname)) {
+    if(threads > 1) {
+      return new parallel_trace_reader(fname, threads);
+    }
+    return new compressed_trace_reader(fname);
+  }
+  return new archive_trace_reader(fname);
+}
@@ -0,0 +1,61 @@
+#ifndef __trace_reader_hh__
+#define __trace_reader_hh__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+
+#include "inst_record.hh"
+
+/* pull interface over a retire trace so the CFG can be built
+ * without holding every dynamic instruction in memory */
+class trace_reader {
+public:
+  virtual ~trace_reader() {}
+  /* append up to max records to chunk, returns number appended
+   * (zero at end of trace) */
+  virtual size_t read(std::vector<inst_record> &chunk, size_t max) = 0;
+  /* tip data, valid once read() has returned zero */
+  virtual const std::map<int64_t, double> &get_tip() const = 0;
+  /* number of records in the whole trace, when the format records
+   * it up front */
+  virtual bool size(uint64_t &n) const {
+    return false;
+  }
+};
+
+/* stands in for T while loading so the archive consumes T's class
+ * preamble (tracking level, version) without loading T itself */
+template <typename T>
+struct archive_preamble {
+  template<class Archive>
+  void serialize(Archive & ar, const unsigned int version) {}
+};
+
+/* walks a boost binary archive of retire_trace record by record,
+ * mirroring the layout retire_trace::serialize produces */
+class archive_trace_reader : public trace_reader {
+private:
+  std::ifstream ifs;
+  boost::archive::binary_iarchive ia;
+  uint64_t remaining = 0, total = 0;
+  std::map<int64_t, double> tip;
+public:
+  archive_trace_reader(const std::string &fname);
+  size_t read(std::vector<inst_record> &chunk, size_t max) override;
+  const std::map<int64_t, double> &get_tip() const override {
+    return tip;
+  }
+  bool size(uint64_t &n) const override {
+    n = total;
+    return true;
+  }
+};
+
+/* picks the reader matching the on-disk format, compressed
+ * traces are decoded on threads workers when threads > 1 */
+trace_reader *open_trace_reader(const std::string &fname, size_t threads = 1);
+
+#endif